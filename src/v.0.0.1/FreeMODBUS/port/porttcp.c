@@ -49,6 +49,7 @@
 /* ----------------------- Defines  -----------------------------------------*/
 #define MB_TCP_DEFAULT_PORT		502 /* TCP listening port. */
 #define MB_TCP_BUF_SIZE			( 256 + 7 ) /* Must hold a complete Modbus TCP frame. */
+#define MB_TCP_RESERVED_CONN	2 /* Connections guaranteed TCP buffers. */
 
 #define EV_CONNECTION			0
 #define EV_CLIENT				1
@@ -86,6 +87,7 @@ xMBTCPPortInit( USHORT usTCPPort ) // ???
 
 	listener = tcp_socket_alloc( modbus_connection_handler );
 	tcp_listen( listener, usTCPPort + 0 );
+	tcp_listen_reserve( listener, MB_TCP_RESERVED_CONN );
 
 	//listener = tcp_socket_alloc( modbus_connection_handler );
 	//tcp_listen( listener, usTCPPort + 1 );
@@ -8,6 +8,10 @@ static int8_t Map[4][4];
 static volatile int8_t nEncoderOld;
 static volatile OPTICAL_ENCODER opticalEncoder;
 
+// Odd while encoderPublishSnapshot() is writing:
+static volatile uint8_t nSnapshotSeq;
+static volatile ENCODER_SNAPSHOT encoderSnapshot;
+
 void InitEncoder(void)
 {
 	DDRE &= ~( ENCODER_A_bm | ENCODER_B_bm );
@@ -27,45 +31,88 @@ void InitEncoder(void)
 	nEncoderPosition = 0;
 	nEncoderOld = PINE & ( ENCODER_A_bm | ENCODER_B_bm );
 
+	nSnapshotSeq = 0;
+	memset( (void*)&encoderSnapshot, 0, sizeof(encoderSnapshot) );
+
 #ifdef __ENCODER_TYPE_X4__ // x4 +++
 
 	// Any logical change on INTn generates an interrupt request:
-	EICRB = 1<<ISC50 | 1<<ISC40;
-	EIMSK = 1<<INT5  | 1<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC50 | 1<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5  | 1<<INT4;
 
 #elif defined __ENCODER_TYPE_1__ // ???
 
 	// The rising edge between two samples of INTn generates an interrupt request:
-	EICRB = 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
-	EIMSK = 1<<INT5 | 1<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5 | 1<<INT4;
 
 #elif defined __ENCODER_TYPE_2__ // ???
 
 	// The rising edge between two samples of INTn generates an interrupt request:
-	EICRB = 1<<ISC51 | 1<<ISC50 | 0<<ISC41 | 0<<ISC40;
-	EIMSK = 1<<INT5 | 0<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC51 | 1<<ISC50 | 0<<ISC41 | 0<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5 | 0<<INT4;
 
 #elif defined __ENCODER_TYPE_3__ // ???
 
 	// The rising edge between two samples of INTn generates an interrupt request:
-	EICRB = 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
-	EIMSK = 1<<INT5 | 1<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5 | 1<<INT4;
 
 #elif defined __ENCODER_TYPE_UP_DOWN_COUNTER__X1__
 
 	// The rising edge between two samples of INTn generates an interrupt request:
-	EICRB = 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
-	EIMSK = 1<<INT5 | 1<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5 | 1<<INT4;
 
 #elif defined __ENCODER_TYPE_UP_DOWN_COUNTER__X2__ // ???
 
 		// Any logical change on INTn generates an interrupt request:
-	EICRB = 1<<ISC50 | 1<<ISC40;
-	EIMSK = 1<<INT5  | 1<<INT4;
+	EICRB = ( EICRB & ~( 1<<ISC51 | 1<<ISC50 | 1<<ISC41 | 1<<ISC40 ) ) | 1<<ISC50 | 1<<ISC40;
+	EIMSK = ( EIMSK & ~( 1<<INT5 | 1<<INT4 ) ) | 1<<INT5  | 1<<INT4;
 
 #endif
 }
 
+/*
+	Called once per servo tick with the position latched under cli().
+	The sequence counter lets readers detect a publish that interrupted
+	their copy, so no reader has to disable interrupts.
+*/
+void encoderPublishSnapshot( int32_t position, uint32_t timestamp )
+{
+	uint32_t dt = timestamp - encoderSnapshot.timestamp;
+	int32_t velocity = position - encoderSnapshot.position;
+
+	if( dt > 1 ) {
+		velocity /= (int32_t)dt;
+	} else
+	if( !dt ) {
+		velocity = 0;
+	}
+
+	++nSnapshotSeq;
+	encoderSnapshot.position = position;
+	encoderSnapshot.velocity = velocity;
+	encoderSnapshot.timestamp = timestamp;
+	++nSnapshotSeq;
+}
+
+/*
+	Must not be called from an interrupt that can preempt the publisher.
+*/
+void encoderGetSnapshot( LP_ENCODER_SNAPSHOT lpSnapshot )
+{
+	uint8_t seq;
+
+	do {
+		while( 1 & ( seq = nSnapshotSeq ) );
+
+		lpSnapshot->position = encoderSnapshot.position;
+		lpSnapshot->velocity = encoderSnapshot.velocity;
+		lpSnapshot->timestamp = encoderSnapshot.timestamp;
+	} while( seq != nSnapshotSeq );
+}
+
 #ifdef __ENCODER_TYPE_X4__
 
 ISR( INT4_vect )
@@ -18,6 +18,20 @@ typedef struct {
 	uint8_t state;
 } OPTICAL_ENCODER, *LP_OPTICAL_ENCODER;
 
+/*
+	Position snapshot published once per servo tick. Readers (Modbus, httpd,
+	UDP) must take it with encoderGetSnapshot() and never touch the raw
+	nEncoderPosition, which is a 32-bit value updated from INT4/INT5.
+*/
+typedef struct {
+	int32_t position;		// encoder counts
+	int32_t velocity;		// counts per servo tick
+	uint32_t timestamp;		// servo tick number of the sample
+} ENCODER_SNAPSHOT, *LP_ENCODER_SNAPSHOT;
+
 void InitEncoder(void);
 
+void encoderPublishSnapshot( int32_t position, uint32_t timestamp );
+void encoderGetSnapshot( LP_ENCODER_SNAPSHOT lpSnapshot );
+
 #endif
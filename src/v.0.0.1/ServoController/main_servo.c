@@ -18,6 +18,7 @@
 
 volatile int32_t nEncoderPosition;
 volatile uint8_t bDoPID;
+volatile uint32_t nServoTicks;
 
 int16_t servoLoop( void )
 {
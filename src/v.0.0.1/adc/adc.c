@@ -22,7 +22,37 @@
 
 #include "adc.h"
 #include <string.h>
-extern uint16_t arrADC[7];
+extern volatile uint32_t nServoTicks;
+
+static const uint8_t adcCmd[NUMBER_OF_ADC_CHANNEL] = {
+	0b10001100,	// CH0 CH7/COM
+	0b10011100,	// CH2 CH7/COM
+	0b10101100,	// CH4 CH7/COM
+	0b10111100,	// CH6 CH7/COM
+	0b11001100,	// CH1 CH7/COM
+	0b11011100,	// CH3 CH7/COM
+	0b11101100	// CH5 CH7/COM
+};
+
+// Command n converts board input adcSlot[n]:
+static const uint8_t adcSlot[NUMBER_OF_ADC_CHANNEL] = {
+	5, 0, 2, 4,
+	6, // ???
+	1, 3
+};
+
+static volatile ADC_FRAME adcRing[ADC_RING_SIZE];
+static volatile uint8_t adcHead;		// frame being filled
+static volatile uint8_t adcLast;		// last completed frame, ADC_RING_SIZE if none
+static volatile uint8_t adcPeriod;		// 0 - sequencer stopped
+static volatile uint8_t adcCountdown;
+
+// One SPI job per conversion, queued back-to-back every frame:
+static struct spi_job adcJob[NUMBER_OF_ADC_CHANNEL];
+static uint8_t adcJobData[NUMBER_OF_ADC_CHANNEL][2];
+
+static void adcSelect(uint8_t select);
+static void adcJobDone(struct spi_job *job);
 
 //////////////////////////////////////////////////////////////////////////////////////
 void adcLoadDefConst(uint16_t *adcConst)
@@ -37,55 +67,126 @@ void adcLoadDefConst(uint16_t *adcConst)
 
 void initAdc(void)
 {
+	uint8_t i;
+
 	select_analog_in();
 	unselect_analog_in();
+
+	// f_OSC / 8:
+	spi_device_init( SPI_DEVICE_ANALOG_IN, adcSelect, (1<<SPR0), (1<<SPI2X) );
+
+	for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+		adcJob[i].data = adcJobData[i];
+		adcJob[i].length = sizeof(adcJobData[i]);
+		adcJob[i].device = SPI_DEVICE_ANALOG_IN;
+		adcJob[i].done = adcJobDone;
+	}
 }
 
-void readADC(void)
+/*
+	Starts sampling all channels every 'period' servo ticks (0 - stop).
+	Frames are converted in the background by the SPI interrupt.
+*/
+void adcSequencerStart(uint8_t period)
 {
-	uint16_t i, arrTemp[7];
-	unsigned char index[7] = {
-		1, 5, 2, 6,
-		3, // ???
-		0, 4
-	};
-
-	for( i = 0; i < 7; i++ ) {	
-		arrTemp[i] = readAdcChannel(i);
+	uint8_t i;
+
+	adcPeriod = 0;
+
+	for( i = 0; i < ADC_RING_SIZE; i++ ) {
+		adcRing[i].seq = 0;
+	}
+	adcHead = 0;
+	adcLast = ADC_RING_SIZE;
+
+	adcCountdown = period;
+	adcPeriod = period;
+}
+
+/*
+	Called from TIMER2_COMP_vect once per servo tick. Queues the
+	conversions of one frame, a frame still on the bus is not restarted.
+*/
+void adcSequencerTick(void)
+{
+	uint8_t i;
+
+	if( !adcPeriod ) {
+		return;
+	}
+
+	if( --adcCountdown ) {
+		return;
 	}
+	adcCountdown = adcPeriod;
 
-	for( i = 0; i < 7; i++ ) {
-		arrADC[i] = arrTemp[ index[i] ];
+	// Jobs finish in order, the last one ends the frame:
+	if( adcJob[NUMBER_OF_ADC_CHANNEL - 1].busy ) {
+		return;
+	}
+
+	++adcRing[adcHead].seq;
+
+	for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+		adcJobData[i][0] = adcCmd[i];
+		adcJobData[i][1] = 0;
+		spi_job_submit( &adcJob[i] );
 	}
 }
 
-uint16_t readAdcChannel( uint8_t n )
+/*
+	Returns the last completed frame.
+	Returns 0 while no frame has been completed yet.
+*/
+uint8_t adcGetFrame(LP_ADC_FRAME lpFrame)
 {
-	volatile uint16_t msb, lsb;
-
-	uint8_t cmd[7] = {
-		0b10001100,	// CH0 CH7/COM
-		0b10011100,	// CH2 CH7/COM
-		0b10101100,	// CH4 CH7/COM
-		0b10111100,	// CH6 CH7/COM
-		0b11001100,	// CH1 CH7/COM
-		0b11011100,	// CH3 CH7/COM
-		0b11101100	// CH5 CH7/COM
-	};
-	
-	select_analog_in();
-	SPCR |= (1<<SPR0);
+	uint8_t n, seq;
+	volatile ADC_FRAME *lpRing;
 
-	SPDR = cmd[n];
-	while( !( SPSR & (1 << SPIF) ) );
-	msb = SPDR;
+	do {
+		n = adcLast;
+		if( n >= ADC_RING_SIZE ) {
+			return 0;
+		}
 
-	SPDR = 0;
-	while( !( SPSR & (1 << SPIF) ) );
-	lsb = SPDR;
+		lpRing = &adcRing[n];
+		seq = lpRing->seq;
 
-	SPCR &= ~(1<<SPR0);
-	unselect_analog_in();
-	
-	return ( (0x0ff0 & (msb<<4)) | (0x000f & (lsb>>4)) );
+		memcpy( lpFrame, (void*)lpRing, sizeof(*lpFrame) );
+	} while( (1 & seq) || seq != lpRing->seq );
+
+	return 1;
+}
+
+static void adcSelect(uint8_t select)
+{
+	if( select ) {
+		select_analog_in();
+	} else {
+		unselect_analog_in();
+	}
+}
+
+// Runs in the SPI interrupt after each conversion:
+static void adcJobDone(struct spi_job *job)
+{
+	volatile ADC_FRAME *lpFrame = &adcRing[adcHead];
+	uint8_t n = job - adcJob, slot = adcSlot[n];
+
+	lpFrame->value[slot] = (0x0ff0 & (job->data[0]<<4)) | (0x000f & (job->data[1]>>4));
+	lpFrame->timestamp[slot] = nServoTicks;
+
+	if( n < NUMBER_OF_ADC_CHANNEL - 1 ) {
+		return;
+	}
+
+	for( n = 0; n < NUMBER_OF_ADC_CHANNEL; n++ ) {
+		lpFrame->filtered[n] = adcFilterUpdate( n, lpFrame->value[n] );
+	}
+
+	++lpFrame->seq;
+	adcLast = adcHead;
+	if( ADC_RING_SIZE == ++adcHead ) {
+		adcHead = 0;
+	}
 }
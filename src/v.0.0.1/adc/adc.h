@@ -18,8 +18,12 @@
 	Last Update:	08.11.2011
 */
 
+#ifndef __ADC_H__
+#define __ADC_H__
+
 #include <stdio.h>
 #include "../main.h"
+#include "adc_filter.h"
 
 #define __ADC_READ_FUNC11__
 
@@ -29,8 +33,22 @@
 
 #define NUMBER_OF_ADC_CHANNEL			7
 
+#define ADC_RING_SIZE					2		// completed frames kept by the sequencer
+#define ADC_SAMPLE_TICKS				1		// servo ticks between two frames
+
+// All arrays are in board input order:
+typedef struct {
+	uint16_t value[NUMBER_OF_ADC_CHANNEL];		// raw 12-bit conversion
+	uint16_t filtered[NUMBER_OF_ADC_CHANNEL];	// filter output, see adc_filter.h
+	uint32_t timestamp[NUMBER_OF_ADC_CHANNEL];	// servo tick of the conversion
+	uint8_t seq;								// odd while the frame is being filled
+} ADC_FRAME, *LP_ADC_FRAME;
+
 void initAdc(void);
-void readADC(void);
-uint16_t readAdcChannel( uint8_t n );
+void adcSequencerStart(uint8_t period);
+void adcSequencerTick(void);
+uint8_t adcGetFrame(LP_ADC_FRAME lpFrame);
 void adcLoadDefConst(uint16_t *adcConst);
 /////////////////////////////////////////////////////
+
+#endif
@@ -0,0 +1,150 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <string.h>
+#include <avr/io.h>
+
+#include "adc.h"
+#include "adc_filter.h"
+
+static ADC_FILTER adcFilter[NUMBER_OF_ADC_CHANNEL];
+
+void adcFilterLoadDefConst(uint16_t *filterConst)
+{
+	uint8_t i;
+
+	for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+		filterConst[i] = ADC_FILTER_NONE;
+	}
+}
+
+/*
+	Restarts the filter of analog input 'n' with a new configuration word.
+	The state is shared with the SPI interrupt, so it is replaced with
+	interrupts disabled.
+*/
+void adcFilterSetup(uint8_t n, uint16_t config)
+{
+	uint8_t sreg, type, k;
+
+	if( n >= NUMBER_OF_ADC_CHANNEL ) {
+		return;
+	}
+
+	// Erased EEPROM:
+	if( 0xffff == config ) {
+		config = ADC_FILTER_NONE;
+	}
+
+	type = ADC_FILTER_TYPE_bm & config;
+	k = (ADC_FILTER_K_bm & config)>>ADC_FILTER_K_bp;
+
+	if( ADC_FILTER_EXPONENTIAL == type ) {
+		if( !k ) k = 1;
+		if( k > ADC_FILTER_MAX_EXP_K ) k = ADC_FILTER_MAX_EXP_K;
+	} else {
+		if( k > ADC_FILTER_MAX_K ) k = ADC_FILTER_MAX_K;
+	}
+
+	sreg = SREG;
+	cli();
+
+	memset( &adcFilter[n], 0, sizeof(*adcFilter) );
+	adcFilter[n].type = type;
+	adcFilter[n].k = k;
+
+	SREG = sreg;
+}
+
+void adcFilterSetupAll(uint16_t *filterConst)
+{
+	uint8_t i;
+
+	for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+		if( 0xffff == filterConst[i] ) {
+			filterConst[i] = ADC_FILTER_NONE;
+		}
+
+		adcFilterSetup( i, filterConst[i] );
+	}
+}
+
+/*
+	Feeds one 12-bit sample of analog input 'n' through its filter and
+	returns the filter output with ADC_FILTER_FRAC_BITS fractional bits.
+	Called from the SPI interrupt once per completed frame.
+*/
+uint16_t adcFilterUpdate(uint8_t n, uint16_t sample)
+{
+	LP_ADC_FILTER lpFilter = &adcFilter[n];
+	uint8_t k = lpFilter->k;
+
+	switch( lpFilter->type ) {
+	case ADC_FILTER_AVERAGE: {
+		uint8_t length = 1<<k;
+
+		// acc[0] - running sum, history[] - the last 'length' samples:
+		lpFilter->acc[0] += sample;
+		lpFilter->acc[0] -= lpFilter->history[lpFilter->count];
+		lpFilter->history[lpFilter->count] = sample;
+
+		if( ++lpFilter->count >= length ) {
+			lpFilter->count = 0;
+		}
+
+		if( k < ADC_FILTER_FRAC_BITS ) {
+			lpFilter->output = lpFilter->acc[0]<<(ADC_FILTER_FRAC_BITS - k);
+		} else {
+			lpFilter->output = lpFilter->acc[0]>>(k - ADC_FILTER_FRAC_BITS);
+		}
+	 }
+	 break;
+
+	case ADC_FILTER_EXPONENTIAL: {
+		// acc[0] - output with 16 fractional bits:
+		int32_t error = ((int32_t)sample<<16) - (int32_t)lpFilter->acc[0];
+
+		lpFilter->acc[0] += error>>k;
+		lpFilter->output = lpFilter->acc[0]>>(16 - ADC_FILTER_FRAC_BITS);
+	 }
+	 break;
+
+	case ADC_FILTER_CIC: {
+		uint32_t comb1, comb2;
+
+		// acc[0..1] - integrators, acc[2..3] - comb delays.
+		// Wrap-around of the integrators cancels out in the combs.
+		lpFilter->acc[0] += sample;
+		lpFilter->acc[1] += lpFilter->acc[0];
+
+		if( ++lpFilter->count < (1<<k) ) {
+			break;
+		}
+		lpFilter->count = 0;
+
+		comb1 = lpFilter->acc[1] - lpFilter->acc[2];
+		lpFilter->acc[2] = lpFilter->acc[1];
+		comb2 = comb1 - lpFilter->acc[3];
+		lpFilter->acc[3] = comb1;
+
+		// Gain of a 2nd order CIC is R^2 = 2^(2K):
+		if( 2 * k < ADC_FILTER_FRAC_BITS ) {
+			lpFilter->output = comb2<<(ADC_FILTER_FRAC_BITS - 2 * k);
+		} else {
+			lpFilter->output = comb2>>(2 * k - ADC_FILTER_FRAC_BITS);
+		}
+	 }
+	 break;
+
+	default:
+		lpFilter->output = sample<<ADC_FILTER_FRAC_BITS;
+	 break;
+	}
+
+	return lpFilter->output;
+}
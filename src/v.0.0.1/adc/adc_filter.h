@@ -0,0 +1,57 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef __ADC_FILTER_H__
+#define __ADC_FILTER_H__
+
+#include <stdint.h>
+
+/*
+	Filter configuration word, one per analog input (uiRegHolding[22..28]):
+
+	BIT[0:1] - filter type:
+		0 - none
+		1 - moving average over 2^K samples
+		2 - exponential, alpha = 1 / 2^K
+		3 - CIC decimator (2nd order), one output every 2^K samples
+	BIT[4:7] - K:
+		0 - 4	for moving average and CIC
+		1 - 8	for exponential
+*/
+#define ADC_FILTER_NONE					0
+#define ADC_FILTER_AVERAGE				1
+#define ADC_FILTER_EXPONENTIAL			2
+#define ADC_FILTER_CIC					3
+
+#define ADC_FILTER_TYPE_bm				0x0003
+#define ADC_FILTER_K_bp					4
+#define ADC_FILTER_K_bm					0x00f0
+
+#define ADC_FILTER_MAX_K				4
+#define ADC_FILTER_MAX_EXP_K			8
+
+// Filter outputs carry 4 fractional bits (12-bit counts * 16):
+#define ADC_FILTER_FRAC_BITS			4
+
+#define adcFilterToCounts( v )			( ( (v) + (1<<(ADC_FILTER_FRAC_BITS - 1)) )>>ADC_FILTER_FRAC_BITS )
+
+typedef struct {
+	uint8_t type;
+	uint8_t k;
+	uint8_t count;
+	uint16_t output;
+	uint32_t acc[4];
+	uint16_t history[1<<ADC_FILTER_MAX_K];
+} ADC_FILTER, *LP_ADC_FILTER;
+
+void adcFilterLoadDefConst(uint16_t *filterConst);
+void adcFilterSetup(uint8_t n, uint16_t config);
+void adcFilterSetupAll(uint16_t *filterConst);
+uint16_t adcFilterUpdate(uint8_t n, uint16_t sample);
+
+#endif
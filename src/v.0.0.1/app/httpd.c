@@ -64,6 +64,8 @@ static httpd_module_callback httpd_modules[] =
 {
 	httpd_module_get_status_xml_callback,
 	httpd_module_do_togle_callback,
+	httpd_module_get_stats_xml_callback,
+	httpd_module_get_netstats_xml_callback,
 
 	httpd_module_dir_callback,
 	httpd_module_file_callback,
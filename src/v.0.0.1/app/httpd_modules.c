@@ -57,9 +57,7 @@ extern uint16_t uiRegInputBuf[];
 extern uint16_t uiRegHolding[];
 extern uint8_t ucRegCoilsBuf[];
 extern uint16_t arrDAC[];
-extern int32_t nEncoderPosition;
 
-extern void ftoa(float f, char *buffer);
 
 static const char PROGMEM httpd_module_file_ending_css[] = ".css";
 static const char PROGMEM httpd_module_file_ending_gif[] = ".gif";
@@ -104,17 +102,24 @@ struct httpd_module_mime_mapping httpd_module_mime_mappings[] PROGMEM =
 
 static PGM_P httpd_module_get_mime_type(const char* uri);
 static void httpd_module_base64_decode(char* str);
+static bool httpd_module_xml_claim(struct httpd_session* session);
+static void httpd_module_xml_begin(struct httpd_session* session);
+static bool httpd_module_xml_send(struct httpd_session* session);
+static void httpd_module_xml_release(struct httpd_session* session);
 
-char data_buffer[1000];
+/* large enough for the counters of /netstats.xml */
+char data_buffer[1600];
+/* the session whose XML response is in data_buffer, and its length */
+static struct httpd_session* data_buffer_session;
+static uint16_t data_buffer_len;
 
 bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum httpd_module_reason reason)
 {
-	static unsigned long fileLen = 0;
-
 	switch(reason) {
 	case HTTPD_MODULE_REASON_CAN_HANDLE_REQUEST: {
 		int i, urlLen = strlen(session->uri) - 1;
-		char length_string[12], buffer[100], sz_float[10];;
+		char buffer[100];
+		ENCODER_SNAPSHOT snapshot;
 
 		while( urlLen >= 0 && session->uri[urlLen] && '/' != session->uri[urlLen] ) {
 			--urlLen;
@@ -124,6 +129,10 @@ bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum ht
 			return false;
 		}
 
+		if( !httpd_module_xml_claim(session) ) {
+			return true;
+		}
+
 		//////////////////////////////////////////////////////////////////////////
 		sprintf(data_buffer, "<response>\n");
 
@@ -140,7 +149,12 @@ bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum ht
 			strcat(data_buffer, buffer);
 		}
 
-		sprintf( buffer, "<ENC_Step>%d</ENC_Step>\n", (int)nEncoderPosition );
+		encoderGetSnapshot( &snapshot );
+
+		sprintf( buffer, "<ENC_Step>%ld</ENC_Step>\n", (long)snapshot.position );
+		strcat(data_buffer, buffer);
+
+		sprintf( buffer, "<ENC_Vel>%ld</ENC_Vel>\n", (long)snapshot.velocity );
 		strcat(data_buffer, buffer);
 
 		for(i = 0; i < 12; i++) {
@@ -158,57 +172,25 @@ bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum ht
 			strcat(data_buffer, buffer);
 		}
 		
-		if( 830 >= uiRegInputBuf[0] ) {
-			ftoa(36.5/(815.0 - 90.0) * ((double)uiRegInputBuf[0]-90), sz_float);
-		} else
-		if( 2160 >= uiRegInputBuf[0] ) {
-			ftoa(100.0/(2140.0 - 90.0) * ((double)uiRegInputBuf[0]-90), sz_float);
-		} else {
-			ftoa(200.0/(4002.0-90.0) * ((double)uiRegInputBuf[0]-90), sz_float);
-		}
+		{
+			int16_t t = calibAdcToCentiDegree( uiRegInputBuf[0] );
 
-		sprintf( buffer, "<T0>%s</T0>", sz_float );
+			sprintf( buffer, "<T0>%s%d.%02d</T0>", t < 0 ? "-" : "", abs(t) / 100, abs(t) % 100 );
+		}
 		strcat(data_buffer, buffer);
 
 		strcat(data_buffer, "</response>\n");
 		//////////////////////////////////////////////////////////////////////////
-		fileLen = strlen(data_buffer);
-		sprintf_P(length_string, PSTR("%lu"), fileLen);
-
-		httpd_session_write_status(session, 200);
-		httpd_session_write_header_P(session, PSTR("Content-Length"), length_string);
-		httpd_session_write_header_PP(session, PSTR("Content-Type"), PSTR("text/xml"));
-		httpd_session_begin_content(session);
+		httpd_module_xml_begin(session);
 	}
 	 return true;
 
 	case HTTPD_MODULE_REASON_HANDLE_REQUEST:
-	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE: {
-		uint16_t space = httpd_session_get_write_buffer_size(session);
-		uint8_t* lpHttpdWriteBuffer = httpd_session_get_write_buffer(session);
-
-		wdt_reset();
-		do {
-			if(!lpHttpdWriteBuffer || space < 1) {
-				break;
-			}
-
-			strncpy( (char*)lpHttpdWriteBuffer, data_buffer, fileLen );
-			if( (1 + fileLen) != httpd_session_reserve_write_buffer(session, fileLen) ) {
-				break;
-			}
-
-			return true;
-		} while(0);
-
-		httpd_session_end_content(session);
-		httpd_session_close(session);
-		return true;
-	}
-	 break;
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE:
+	 return httpd_module_xml_send(session);
 
 	case HTTPD_MODULE_REASON_CLEANUP:
-		fileLen = 0;
+		httpd_module_xml_release(session);
 	 return true;
 	}
 
@@ -217,8 +199,6 @@ bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum ht
 
 bool httpd_module_do_togle_callback(struct httpd_session* session, enum httpd_module_reason reason)
 {
-	static unsigned long fileLen = 0;
-
 	switch(reason) {
 	case HTTPD_MODULE_REASON_CAN_HANDLE_REQUEST: {
 		int i, len = strlen(session->uri) - 1;
@@ -239,9 +219,12 @@ bool httpd_module_do_togle_callback(struct httpd_session* session, enum httpd_mo
 		i = atoi(lpIndex);
 
 		if( i >= 0 && i < 12 ) {
-			char length_string[12];
 			char buffer[100];
 
+			if( !httpd_module_xml_claim(session) ) {
+				return true;
+			}
+
 			ucRegCoilsBuf[i/8] ^= 1<<(i - 8*(i/8));
 			//////////////////////////////////////////////////////
 			sprintf(data_buffer, "<response>\n");
@@ -257,13 +240,7 @@ bool httpd_module_do_togle_callback(struct httpd_session* session, enum httpd_mo
 			
 			strcat(data_buffer, "</response>\n");
 			//////////////////////////////////////////////////////
-			fileLen = strlen(data_buffer);
-			sprintf_P(length_string, PSTR("%lu"), fileLen);
-
-			httpd_session_write_status(session, 200);
-			httpd_session_write_header_P(session, PSTR("Content-Length"), length_string);
-			httpd_session_write_header_PP(session, PSTR("Content-Type"), PSTR("text/xml"));
-			httpd_session_begin_content(session);
+			httpd_module_xml_begin(session);
 
 			return true;
 		}
@@ -271,32 +248,144 @@ bool httpd_module_do_togle_callback(struct httpd_session* session, enum httpd_mo
 	 break;
 
 	case HTTPD_MODULE_REASON_HANDLE_REQUEST:
-	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE: {
-		uint16_t space = httpd_session_get_write_buffer_size(session);
-		uint8_t* lpHttpdWriteBuffer = httpd_session_get_write_buffer(session);
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE:
+	 return httpd_module_xml_send(session);
 
-		wdt_reset();
-		do {
-			if(!lpHttpdWriteBuffer || space < 1) {
-				break;
-			}
+	case HTTPD_MODULE_REASON_CLEANUP:
+		httpd_module_xml_release(session);
+	 return true;
+	}
 
-			strncpy( (char*)lpHttpdWriteBuffer, data_buffer, fileLen );
-			if( (1 + fileLen) != httpd_session_reserve_write_buffer(session, fileLen) ) {
-				break;
-			}
-		} while(0);
+	return false;
+}
 
+/**
+ * \internal
+ * A module reporting the main loop profile.
+ *
+ * Serves "/stats.xml" with the loop rate and the min/avg/max time in
+ * microseconds of every main loop stage over the last second, see prof/prof.h.
+ */
+bool httpd_module_get_stats_xml_callback(struct httpd_session* session, enum httpd_module_reason reason)
+{
+	switch(reason) {
+	case HTTPD_MODULE_REASON_CAN_HANDLE_REQUEST: {
+		int urlLen = strlen(session->uri) - 1;
+		uint8_t i;
+		char buffer[100];
 
-		httpd_session_end_content(session);
-		httpd_session_close(session);
+		while( urlLen >= 0 && session->uri[urlLen] && '/' != session->uri[urlLen] ) {
+			--urlLen;
+		}
+
+		if( strncmp_P(session->uri + urlLen, PSTR("/stats.xml"), 10) ) {
+			return false;
+		}
+
+		if( !httpd_module_xml_claim(session) ) {
+			return true;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		sprintf(data_buffer, "<response>\n");
+
+		sprintf_P(buffer, PSTR("<loop_rate>%u</loop_rate>\n"), profGetLoopRate());
+		strcat(data_buffer, buffer);
+
+		for(i = 0; i < NUMBER_OF_PROF_STAGE; i++) {
+			PROF_STAGE stage;
+
+			profGetStage(i, &stage);
+
+			sprintf_P(
+				buffer,
+				PSTR("<stage name=\"%S\"><min>%u</min><avg>%u</avg><max>%u</max></stage>\n"),
+				profGetStageName(i),
+				stage.min,
+				stage.avg,
+				stage.max
+			);
+			strcat(data_buffer, buffer);
+		}
+
+		strcat(data_buffer, "</response>\n");
+		//////////////////////////////////////////////////////////////////////////
+		httpd_module_xml_begin(session);
 	}
 	 return true;
 
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST:
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE:
+	 return httpd_module_xml_send(session);
+
 	case HTTPD_MODULE_REASON_CLEANUP:
-		fileLen = 0;
+		httpd_module_xml_release(session);
 	 return true;
+	}
 
+	return false;
+}
+
+/**
+ * \internal
+ * A module reporting the network statistics.
+ *
+ * Serves "/netstats.xml" with the event counters of all network layers,
+ * see net/net_stats.h, and the byte counters of the TCP receive path.
+ */
+bool httpd_module_get_netstats_xml_callback(struct httpd_session* session, enum httpd_module_reason reason)
+{
+	switch(reason) {
+	case HTTPD_MODULE_REASON_CAN_HANDLE_REQUEST: {
+		int urlLen = strlen(session->uri) - 1;
+		uint8_t i;
+		char buffer[100];
+
+		while( urlLen >= 0 && session->uri[urlLen] && '/' != session->uri[urlLen] ) {
+			--urlLen;
+		}
+
+		if( strncmp_P(session->uri + urlLen, PSTR("/netstats.xml"), 13) ) {
+			return false;
+		}
+
+		if( !httpd_module_xml_claim(session) ) {
+			return true;
+		}
+
+		//////////////////////////////////////////////////////////////////////////
+		const uint16_t* netStats = net_stats_get();
+		const struct tcp_rx_stats* rxStats = tcp_get_rx_stats();
+
+		sprintf(data_buffer, "<response>\n");
+
+		for(i = 0; i < NET_STAT_COUNT; i++) {
+			sprintf_P(buffer, PSTR("<stat name=\"%S\">%u</stat>\n"), net_stats_get_name(i), netStats[i]);
+			strcat(data_buffer, buffer);
+		}
+
+		sprintf_P(
+			buffer,
+			PSTR("<tcp_rx><received>%lu</received><queued>%lu</queued><direct>%lu</direct></tcp_rx>\n"),
+			rxStats->bytes_received,
+			rxStats->bytes_queued,
+			rxStats->bytes_direct
+		);
+		strcat(data_buffer, buffer);
+
+		strcat(data_buffer, "</response>\n");
+		//////////////////////////////////////////////////////////////////////////
+		httpd_module_xml_begin(session);
+	}
+	 return true;
+
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST:
+	case HTTPD_MODULE_REASON_HANDLE_REQUEST_CONTINUE:
+	 return httpd_module_xml_send(session);
+
+	case HTTPD_MODULE_REASON_CLEANUP:
+		httpd_module_xml_release(session);
+	 return true;
 	}
 
 	return false;
@@ -345,7 +434,7 @@ bool httpd_module_dir_callback(struct httpd_session* session, enum httpd_module_
 				return true;
 			}
 
-			session->user = (uint16_t) fat16_open_dir(sd_get_fs(), &dir_entry);
+			session->user = (uintptr_t) fat16_open_dir(sd_get_fs(), &dir_entry);
 			dd = (struct fat16_dir_struct*) session->user;
 
 			if(!dd) {
@@ -435,7 +524,7 @@ bool httpd_module_file_callback(struct httpd_session* session, enum httpd_module
 		}
 
 		if(fat16_get_dir_entry_of_path(sd_get_fs(), session->uri + 3, &dir_entry)) {
-			session->user = (uint16_t)fat16_open_file(sd_get_fs(), &dir_entry);
+			session->user = (uintptr_t) fat16_open_file(sd_get_fs(), &dir_entry);
 		} else {
 			session->user = 0;
 		}
@@ -685,6 +774,112 @@ bool httpd_module_demo_arg_callback(struct httpd_session* session, enum httpd_mo
 	}
 }
 
+/**
+ * \internal
+ * Reserves data_buffer for the XML response of a session.
+ *
+ * If another session is still sending its response from the buffer,
+ * the request is answered with 503 and the session gets closed.
+ *
+ * \param[in] session The session which is about to fill data_buffer.
+ * \returns \c true if the session may use the buffer, \c false otherwise.
+ */
+bool httpd_module_xml_claim(struct httpd_session* session)
+{
+	if(data_buffer_session && data_buffer_session != session) {
+		httpd_session_write_error(session, 503);
+		httpd_session_close(session);
+		return false;
+	}
+
+	data_buffer_session = session;
+	return true;
+}
+
+/**
+ * \internal
+ * Sends the status line and headers of the XML response in data_buffer.
+ *
+ * \param[in] session The session which claimed data_buffer.
+ */
+void httpd_module_xml_begin(struct httpd_session* session)
+{
+	char length_string[12];
+
+	data_buffer_len = strlen(data_buffer);
+	session->user = 0;
+
+	sprintf_P(length_string, PSTR("%u"), data_buffer_len);
+
+	httpd_session_write_status(session, 200);
+	httpd_session_write_header_P(session, PSTR("Content-Length"), length_string);
+	httpd_session_write_header_PP(session, PSTR("Content-Type"), PSTR("text/xml"));
+	httpd_session_begin_content(session);
+}
+
+/**
+ * \internal
+ * Sends the body of the XML response in data_buffer.
+ *
+ * Writes as much as the transmit buffer takes and continues when the
+ * session is called again, \c session->user counts the bytes sent.
+ * The session gets closed after the last byte or on failure.
+ *
+ * \param[in] session The session which claimed data_buffer.
+ * \returns \c true, the session always stays with the module.
+ */
+bool httpd_module_xml_send(struct httpd_session* session)
+{
+	if(session != data_buffer_session) {
+		return true;
+	}
+
+	uint16_t space = httpd_session_get_write_buffer_size(session);
+	uint8_t* lpHttpdWriteBuffer = httpd_session_get_write_buffer(session);
+	uint16_t len = data_buffer_len - session->user;
+
+	wdt_reset();
+	do {
+		if(!lpHttpdWriteBuffer || len < 1) {
+			break;
+		}
+
+		if(len > space) {
+			len = space;
+		}
+
+		if(len > 0) {
+			memcpy( lpHttpdWriteBuffer, data_buffer + session->user, len );
+			if( (int16_t)len != httpd_session_reserve_write_buffer(session, len) ) {
+				break;
+			}
+			session->user += len;
+		}
+
+		if(session->user < data_buffer_len) {
+			return true;
+		}
+	} while(0);
+
+	httpd_session_end_content(session);
+	httpd_session_close(session);
+	httpd_module_xml_release(session);
+	return true;
+}
+
+/**
+ * \internal
+ * Gives data_buffer back if the session holds it.
+ *
+ * \param[in] session The session which ends.
+ */
+void httpd_module_xml_release(struct httpd_session* session)
+{
+	if(session == data_buffer_session) {
+		data_buffer_session = 0;
+	}
+}
+
 /**
  * Determines the mime-type of a HTTP transfer by the file extension.
  *
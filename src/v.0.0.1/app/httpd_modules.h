@@ -58,6 +58,8 @@ typedef bool (*httpd_module_callback)(struct httpd_session* session, enum httpd_
 
 bool httpd_module_get_status_xml_callback(struct httpd_session* session, enum httpd_module_reason reason);
 bool httpd_module_do_togle_callback(struct httpd_session* session, enum httpd_module_reason reason);
+bool httpd_module_get_stats_xml_callback(struct httpd_session* session, enum httpd_module_reason reason);
+bool httpd_module_get_netstats_xml_callback(struct httpd_session* session, enum httpd_module_reason reason);
 
 bool httpd_module_dir_callback(struct httpd_session* session, enum httpd_module_reason reason);
 bool httpd_module_file_callback(struct httpd_session* session, enum httpd_module_reason reason);
@@ -8,9 +8,11 @@
  */
 
 #include <avr/io.h>
+#include <avr/interrupt.h>
 
 #include "spi.h"
 #include "spi_config.h"
+#include "timebase.h"
 
 /**
  * \addtogroup arch Architecture and hardware specific services
@@ -31,6 +33,35 @@
  * \author Roland Riegel
  */
 
+/**
+ * A device served by the job scheduler.
+ */
+struct spi_device
+{
+	spi_select_callback select;
+	uint8_t spcr;
+	uint8_t spsr;
+};
+
+static struct spi_device spi_devices[SPI_MAX_DEVICES];
+static struct spi_stats spi_stats[SPI_MAX_DEVICES + 1];
+
+static volatile uint8_t spi_bus_locks;
+static uint16_t spi_bus_lock_start;
+
+static struct spi_job* volatile spi_job_head;
+static struct spi_job* volatile spi_job_tail;
+static volatile uint8_t spi_job_running;
+static uint8_t spi_job_active;
+static uint8_t spi_job_pos;
+static uint16_t spi_job_start;
+static uint8_t spi_saved_spcr;
+static uint8_t spi_saved_spsr;
+
+static void spi_set_config(uint8_t spcr, uint8_t spsr);
+static void spi_job_start_next();
+static void spi_stats_add(struct spi_stats* stats, uint16_t time, uint8_t bytes);
+
 /**
  * Initializes the SPI interface.
  *
@@ -115,15 +146,17 @@ void spi_rec_data(uint8_t* buffer, uint16_t buffer_len)
  */
 void spi_low_frequency()
 {
-	SPCR =	(0<<SPIE) | /* SPI Interrupt Enable */
+	spi_set_config(
+			(0<<SPIE) | /* SPI Interrupt Enable */
 			(1<<SPE)  | /* SPI Enable */
 			(0<<DORD) | /* Data Order: MSB first */
 			(1<<MSTR) | /* Master mode */
 			(0<<CPOL) | /* Clock Polarity: SCK low when idle */
 			(0<<CPHA) | /* Clock Phase: sample on rising SCK edge */
 			(1<<SPR1) | /* Clock Frequency: f_OSC / 128 */
-			(1<<SPR0);
-	SPSR &= ~(1<<SPI2X); /* No Doubled Clock Frequency */
+			(1<<SPR0),
+			(0<<SPI2X)  /* No Doubled Clock Frequency */
+	);
 }
 
 /**
@@ -131,15 +164,326 @@ void spi_low_frequency()
  */
 void spi_high_frequency()
 {
-	SPCR =	(0<<SPIE) | /* SPI Interrupt Enable */
+	spi_set_config(
+			(0<<SPIE) | /* SPI Interrupt Enable */
 			(1<<SPE)  | /* SPI Enable */
 			(0<<DORD) | /* Data Order: MSB first */
 			(1<<MSTR) | /* Master mode */
 			(0<<CPOL) | /* Clock Polarity: SCK low when idle */
 			(0<<CPHA) | /* Clock Phase: sample on rising SCK edge */
 			(0<<SPR1) | /* Clock Frequency: f_OSC / 4 */
-			(0<<SPR0);
-	SPSR |= (1<<SPI2X); /* Doubled Clock Frequency: f_OSC / 2 */
+			(0<<SPR0),
+			(1<<SPI2X)  /* Doubled Clock Frequency: f_OSC / 2 */
+	);
+}
+
+/**
+ * Applies the SPI configuration of the blocking drivers.
+ *
+ * While the scheduler runs jobs, the configuration is stored and
+ * takes effect when the scheduler stops.
+ */
+static void spi_set_config(uint8_t spcr, uint8_t spsr)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	if(spi_job_active) {
+		spi_saved_spcr = spcr;
+		spi_saved_spsr = spsr;
+	} else {
+		SPCR = spcr;
+		SPSR = spsr;
+	}
+
+	SREG = sreg;
+}
+
+/**
+ * Claims the SPI bus for one blocking transaction from the main loop.
+ *
+ * Waits until a running job has finished. While the bus is locked, the
+ * scheduler does not start any queued job, they are deferred until the
+ * matching spi_bus_unlock(). Calls may be nested.
+ *
+ * The lock is meant to cover a single chip select cycle of a blocking
+ * driver. An urgent job is delayed by the longest of them, so the
+ * drivers split long transfers and give the bus back in between (see
+ * ENC424J600_SPI_BURST). The longest lock is kept in the statistics
+ * under SPI_STATS_BLOCKING.
+ *
+ * The longest cycle is the read of an SD card block, which cannot be
+ * split as the card has to stay selected from the command up to the CRC
+ * of the block. At f_OSC / 2 it locks the bus for about 0.8 ms plus the
+ * access time of the card, and for up to about 17 ms when the card never
+ * sends the start of the block (see sd_raw_read()).
+ *
+ * \note Must not be called from an interrupt service routine or with
+ *       interrupts disabled while a job is running.
+ */
+void spi_bus_lock()
+{
+	uint8_t sreg = SREG;
+	uint8_t first;
+
+	cli();
+	first = !spi_bus_locks++;
+	SREG = sreg;
+
+	/* the scheduler does not start another job from now on */
+	while(spi_job_running);
+
+	if(first)
+		spi_bus_lock_start = timebase_now();
+}
+
+/**
+ * Releases the SPI bus claimed with spi_bus_lock().
+ *
+ * Starts the deferred jobs when the last lock is released.
+ */
+void spi_bus_unlock()
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	if(spi_bus_locks && !--spi_bus_locks) {
+		spi_stats_add(&spi_stats[SPI_STATS_BLOCKING], timebase_now() - spi_bus_lock_start, 0);
+		spi_job_start_next();
+	}
+
+	SREG = sreg;
+}
+
+/**
+ * Configures a device served by the job scheduler.
+ *
+ * \param[in] device The device number, less than SPI_MAX_DEVICES.
+ * \param[in] select The function which drives the chip select line of the device.
+ * \param[in] spcr The SPCR value for the device's clock rate and mode, without SPIE.
+ * \param[in] spsr The SPSR value for the device, only SPI2X is used.
+ */
+void spi_device_init(uint8_t device, spi_select_callback select, uint8_t spcr, uint8_t spsr)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	spi_devices[device].select = select;
+	spi_devices[device].spcr = spcr | (1 << SPE) | (1 << MSTR);
+	spi_devices[device].spsr = spsr & (1 << SPI2X);
+
+	SREG = sreg;
+}
+
+/**
+ * Appends a job to the scheduler queue.
+ *
+ * The job is started as soon as the bus is free. Jobs run back-to-back
+ * from the SPI interrupt, each one with the clock rate and mode of its
+ * device.
+ *
+ * \note May be called from an interrupt service routine.
+ *
+ * \param[in] job The job, which must stay valid until it has finished.
+ * \returns 0 if the job is still busy and was not queued again, 1 otherwise.
+ */
+uint8_t spi_job_submit(struct spi_job* job)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	if(job->busy) {
+		SREG = sreg;
+		return 0;
+	}
+
+	job->busy = 1;
+	job->next = 0;
+
+	if(spi_job_tail)
+		spi_job_tail->next = job;
+	else
+		spi_job_head = job;
+	spi_job_tail = job;
+
+	spi_job_start_next();
+
+	SREG = sreg;
+	return 1;
+}
+
+/**
+ * Queues a job in front of all other waiting jobs.
+ *
+ * A running job or blocking transaction is not interrupted, so the job
+ * starts after at most one of them.
+ *
+ * \note May be called from an interrupt service routine.
+ *
+ * \param[in] job The job, which must stay valid until it has finished.
+ * \returns 0 if the job is still busy and was not queued again, 1 otherwise.
+ */
+uint8_t spi_job_submit_urgent(struct spi_job* job)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	if(job->busy) {
+		SREG = sreg;
+		return 0;
+	}
+
+	job->busy = 1;
+
+	if(spi_job_running) {
+		job->next = spi_job_head->next;
+		spi_job_head->next = job;
+		if(spi_job_tail == spi_job_head)
+			spi_job_tail = job;
+	} else {
+		job->next = spi_job_head;
+		spi_job_head = job;
+		if(!spi_job_tail)
+			spi_job_tail = job;
+	}
+
+	spi_job_start_next();
+
+	SREG = sreg;
+	return 1;
+}
+
+/**
+ * Waits until a job has finished.
+ *
+ * \note Must not be called while the bus is locked by the caller.
+ *
+ * \param[in] job The job to wait for.
+ */
+void spi_job_wait(const struct spi_job* job)
+{
+	while(job->busy);
+}
+
+/**
+ * Retrieves the bus usage statistics of a device.
+ *
+ * \param[in] index The device number or SPI_STATS_BLOCKING.
+ * \param[out] stats A pointer to the structure which receives the statistics.
+ */
+void spi_get_stats(uint8_t index, struct spi_stats* stats)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	*stats = spi_stats[index];
+
+	SREG = sreg;
+}
+
+/**
+ * Restarts the maximum time statistics of a device.
+ *
+ * \param[in] index The device number or SPI_STATS_BLOCKING.
+ */
+void spi_reset_max_time(uint8_t index)
+{
+	uint8_t sreg = SREG;
+	cli();
+
+	spi_stats[index].max_time = 0;
+
+	SREG = sreg;
+}
+
+/**
+ * Starts the job at the head of the queue, if possible.
+ *
+ * Restores the SPI configuration of the blocking drivers when
+ * the scheduler stops.
+ *
+ * \note Must be called with interrupts disabled.
+ */
+static void spi_job_start_next()
+{
+	struct spi_job* job = spi_job_head;
+	struct spi_device* device;
+
+	if(spi_job_running)
+		return;
+
+	if(!job || spi_bus_locks) {
+		if(spi_job_active) {
+			SPCR = spi_saved_spcr;
+			SPSR = spi_saved_spsr;
+			spi_job_active = 0;
+		}
+		return;
+	}
+
+	if(!spi_job_active) {
+		spi_saved_spcr = SPCR;
+		spi_saved_spsr = SPSR;
+		spi_job_active = 1;
+
+		/* clear a completion flag left over by the blocking drivers */
+		if(SPSR & (1 << SPIF))
+			(void) SPDR;
+	}
+
+	device = &spi_devices[job->device];
+	SPCR = device->spcr | (1 << SPIE);
+	SPSR = device->spsr;
+
+	spi_job_pos = 0;
+	spi_job_running = 1;
+	spi_job_start = timebase_now();
+
+	device->select(1);
+	SPDR = job->data[0];
+}
+
+/**
+ * Adds a finished job or lock to the statistics.
+ */
+static void spi_stats_add(struct spi_stats* stats, uint16_t time, uint8_t bytes)
+{
+	++stats->jobs;
+	stats->bytes += bytes;
+	stats->bus_time += time;
+	if(time > stats->max_time)
+		stats->max_time = time;
+}
+
+/**
+ * Shifts the bytes of the running job and chains the next one.
+ */
+ISR(SPI_STC_vect)
+{
+	struct spi_job* job = spi_job_head;
+	uint8_t pos = spi_job_pos;
+
+	job->data[pos] = SPDR;
+
+	if(++pos < job->length) {
+		spi_job_pos = pos;
+		SPDR = job->data[pos];
+		return;
+	}
+
+	spi_devices[job->device].select(0);
+	spi_stats_add(&spi_stats[job->device], timebase_now() - spi_job_start, job->length);
+
+	spi_job_head = job->next;
+	if(!spi_job_head)
+		spi_job_tail = 0;
+	spi_job_running = 0;
+	job->busy = 0;
+
+	if(job->done)
+		job->done(job);
+
+	spi_job_start_next();
 }
 
 /**
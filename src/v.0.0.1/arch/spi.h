@@ -38,6 +38,77 @@ void spi_rec_data(uint8_t* buffer, uint16_t buffer_len);
 void spi_low_frequency();
 void spi_high_frequency();
 
+/**
+ * The maximum number of devices served by the job scheduler.
+ */
+#define SPI_MAX_DEVICES 5
+
+/**
+ * The statistics index of the blocking transactions done between
+ * spi_bus_lock() and spi_bus_unlock().
+ */
+#define SPI_STATS_BLOCKING SPI_MAX_DEVICES
+
+/**
+ * The type of function which drives the chip select line of a device.
+ *
+ * \param[in] select Nonzero to select the device, zero to deselect it.
+ */
+typedef void (*spi_select_callback)(uint8_t select);
+
+struct spi_job;
+
+/**
+ * The type of function which is called when a job has finished.
+ */
+typedef void (*spi_job_callback)(struct spi_job* job);
+
+/**
+ * A transfer framed by one chip select cycle.
+ */
+struct spi_job
+{
+    /** The next job in the queue, managed by the scheduler. */
+    struct spi_job* next;
+    /** The bytes to send, overwritten with the bytes received. */
+    uint8_t* data;
+    /** The number of bytes to transfer, at least one. */
+    uint8_t length;
+    /** The device addressed by the job. */
+    uint8_t device;
+    /** Called from interrupt context after the job, may be 0. */
+    spi_job_callback done;
+    /** Nonzero while the job is queued or running. */
+    volatile uint8_t busy;
+};
+
+/**
+ * Bus usage statistics of a device.
+ */
+struct spi_stats
+{
+    /** The number of jobs or locks. */
+    uint16_t jobs;
+    /** The number of bytes transferred by jobs. */
+    uint32_t bytes;
+    /** The accumulated bus time in timebase ticks. */
+    uint32_t bus_time;
+    /** The longest single job or lock in timebase ticks, see spi_reset_max_time(). */
+    uint16_t max_time;
+};
+
+void spi_bus_lock();
+void spi_bus_unlock();
+
+void spi_device_init(uint8_t device, spi_select_callback select, uint8_t spcr, uint8_t spsr);
+
+uint8_t spi_job_submit(struct spi_job* job);
+uint8_t spi_job_submit_urgent(struct spi_job* job);
+void spi_job_wait(const struct spi_job* job);
+
+void spi_get_stats(uint8_t index, struct spi_stats* stats);
+void spi_reset_max_time(uint8_t index);
+
 /**
  * @}
  * @}
@@ -0,0 +1,109 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timebase.h"
+
+/**
+ * \addtogroup arch
+ *
+ * @{
+ */
+/**
+ * \addtogroup arch_timebase Free running timebase
+ *
+ * A 16-bit counter for measuring short durations, e.g. bus and
+ * execution times. It wraps after 65536 / TIMEBASE_TICKS_PER_US
+ * microseconds, so only differences of up to that length are valid.
+ * timebase_now32() extends it by the number of overflows for longer
+ * durations such as network round trip times.
+ *
+ * \note Uses Timer3, which must not be used for anything else.
+ *
+ * @{
+ */
+/**
+ * \file
+ * Free running timebase implementation
+ */
+
+static volatile uint16_t timebase_overflows;
+
+/**
+ * Starts Timer3 in normal mode with a prescaler of 8.
+ */
+void timebase_init()
+{
+	TCCR3A = 0;
+	TCCR3B = (1 << CS31);
+	TCNT3 = 0;
+
+	/* count overflows for timebase_now32() */
+	ETIFR = (1 << TOV3);
+	ETIMSK |= (1 << TOIE3);
+}
+
+/**
+ * Reads the current timebase value.
+ *
+ * \note May be called from an interrupt service routine.
+ *
+ * \returns The counter value in units of 1 / TIMEBASE_TICKS_PER_US microseconds.
+ */
+uint16_t timebase_now()
+{
+	uint8_t sreg = SREG;
+	uint16_t now;
+
+	/* the 16-bit read goes through the shared TEMP register */
+	cli();
+	now = TCNT3;
+	SREG = sreg;
+
+	return now;
+}
+
+/**
+ * Reads the current timebase value extended to 32 bits.
+ *
+ * \note May be called from an interrupt service routine.
+ *
+ * \returns The counter value in units of 1 / TIMEBASE_TICKS_PER_US microseconds.
+ */
+uint32_t timebase_now32()
+{
+	uint8_t sreg = SREG;
+	uint16_t high;
+	uint16_t low;
+
+	cli();
+	low = TCNT3;
+	high = timebase_overflows;
+	/* the counter wrapped, but the interrupt has not run yet */
+	if((ETIFR & (1 << TOV3)) && low < 0x8000)
+		++high;
+	SREG = sreg;
+
+	return ((uint32_t) high << 16) | low;
+}
+
+/**
+ * Counts the wraps of the 16-bit counter.
+ */
+ISR(TIMER3_OVF_vect)
+{
+	++timebase_overflows;
+}
+
+/**
+ * @}
+ * @}
+ */
+
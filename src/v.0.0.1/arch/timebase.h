@@ -0,0 +1,44 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stdint.h>
+
+/**
+ * \addtogroup arch
+ *
+ * @{
+ */
+/**
+ * \addtogroup arch_timebase
+ *
+ * @{
+ */
+/**
+ * \file
+ * Free running timebase header
+ */
+
+/**
+ * The number of timebase ticks per microsecond.
+ */
+#define TIMEBASE_TICKS_PER_US (F_CPU / 8 / 1000000UL)
+
+void timebase_init();
+uint16_t timebase_now();
+uint32_t timebase_now32();
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
+
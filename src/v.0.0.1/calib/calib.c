@@ -0,0 +1,112 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "../main.h"
+#include "calib.h"
+
+typedef struct {
+	uint16_t limit;			// last ADC count of the segment
+	uint16_t centiDegree;	// temperature rise over 'counts', in 0.01 deg
+	uint16_t counts;
+} CALIB_SEGMENT;
+
+// Temperature sensor on analog input 0, piecewise linear from 90 counts:
+#define CALIB_TEMP_ZERO					90
+#define CALIB_TEMP_SEGMENTS				3
+
+static const CALIB_SEGMENT calibTempCurve[CALIB_TEMP_SEGMENTS] PROGMEM = {
+	{  830,  3650,  815 - CALIB_TEMP_ZERO },
+	{ 2160, 10000, 2140 - CALIB_TEMP_ZERO },
+	{ 0xffff, 20000, 4002 - CALIB_TEMP_ZERO }
+};
+
+// Largest ADC gain whose product with 12-bit counts still fits 32 bits:
+#define CALIB_ADC_GAIN_MAX				( (0xfffffffful - 0x8000) / 0x0fff )
+
+// Gains with 16 fractional bits:
+static uint32_t calibAdcGain[NUMBER_OF_ADC_CHANNEL];
+static uint32_t calibDacGain[NUMBER_OF_DAC_CHANNEL];
+static int32_t calibTempSlope[CALIB_TEMP_SEGMENTS];
+
+void calibInit(uint16_t *adcConst, uint16_t *dacConst)
+{
+	uint8_t i;
+
+	// ADCnConst = 10 * counts at 10.00 V, U = 10000 * counts / ADCnConst:
+	for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+		if( adcConst[i] ) {
+			calibAdcGain[i] = ( (10000ul<<16) + adcConst[i] / 2 ) / adcConst[i];
+			if( calibAdcGain[i] > CALIB_ADC_GAIN_MAX ) {
+				calibAdcGain[i] = CALIB_ADC_GAIN_MAX;
+			}
+		} else {
+			calibAdcGain[i] = 0;
+		}
+	}
+
+	// DACnConst = code at 10.00 V, code = DACnConst * U / 1000:
+	for( i = 0; i < NUMBER_OF_DAC_CHANNEL; i++ ) {
+		calibDacGain[i] = ( ((uint32_t)dacConst[i]<<16) + 500 ) / 1000;
+	}
+
+	for( i = 0; i < CALIB_TEMP_SEGMENTS; i++ ) {
+		uint32_t num = pgm_read_word( &calibTempCurve[i].centiDegree );
+		uint16_t den = pgm_read_word( &calibTempCurve[i].counts );
+
+		calibTempSlope[i] = ( (num<<16) + den / 2 ) / den;
+	}
+}
+
+uint16_t calibAdcToCentiVolt(uint8_t n, uint16_t counts)
+{
+	uint32_t centiVolt;
+
+	if( n >= NUMBER_OF_ADC_CHANNEL ) {
+		return 0;
+	}
+
+	counts &= 0x0fff;
+	if( counts < __ADC_OFFSET__ ) {
+		return 0;
+	}
+	counts -= __ADC_OFFSET__;
+
+	centiVolt = ( (uint32_t)counts * calibAdcGain[n] + 0x8000 )>>16;
+
+	return ( centiVolt > 0xffff ) ? 0xffff : centiVolt;
+}
+
+uint16_t calibCentiVoltToDac(uint8_t n, uint16_t centiVolt)
+{
+	uint32_t code;
+
+	if( n >= NUMBER_OF_DAC_CHANNEL ) {
+		return 0;
+	}
+
+	if( centiVolt > CALIB_DAC_FULL_SCALE ) {
+		centiVolt = CALIB_DAC_FULL_SCALE;
+	}
+
+	code = ( (uint32_t)centiVolt * calibDacGain[n] + 0x8000 )>>16;
+
+	return ( code > 0xffff ) ? 0xffff : code;
+}
+
+int16_t calibAdcToCentiDegree(uint16_t counts)
+{
+	uint8_t i;
+
+	for( i = 0; i < CALIB_TEMP_SEGMENTS - 1; i++ ) {
+		if( counts <= pgm_read_word( &calibTempCurve[i].limit ) ) {
+			break;
+		}
+	}
+
+	return ( ((int32_t)counts - CALIB_TEMP_ZERO) * calibTempSlope[i] )>>16;
+}
@@ -0,0 +1,28 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef __CALIB_H__
+#define __CALIB_H__
+
+#include <stdint.h>
+
+#define CALIB_ADC_FULL_SCALE			1000	// 10.00 V in 0.01 V units
+#define CALIB_DAC_FULL_SCALE			1000	// 10.00 V in 0.01 V units
+
+/*
+	Fixed-point calibration tables. Rebuilt from the ADC/DAC constants
+	(uiRegHolding[5..13]) whenever those change, so the conversions below
+	only need a 32-bit multiply and a shift.
+*/
+void calibInit(uint16_t *adcConst, uint16_t *dacConst);
+
+uint16_t calibAdcToCentiVolt(uint8_t n, uint16_t counts);
+uint16_t calibCentiVoltToDac(uint8_t n, uint16_t centiVolt);
+int16_t calibAdcToCentiDegree(uint16_t counts);
+
+#endif
@@ -24,6 +24,36 @@
 #include "dac.h"
 
 extern uint16_t uiRegHolding[];
+extern volatile uint32_t nServoTicks;
+
+// One SPI job per channel, queued at the start of every servo tick:
+static struct spi_job dacJob[NUMBER_OF_DAC_CHANNEL];
+static uint8_t dacJobData[NUMBER_OF_DAC_CHANNEL][3];
+
+// Double buffer: writeDac() fills the pending values, dacTick() latches
+// them into the jobs. The servo tick they were computed for goes along:
+static volatile uint16_t dacValue[NUMBER_OF_DAC_CHANNEL];
+static volatile uint32_t dacValueTick;
+static uint32_t dacJobTick;
+static uint32_t dacOutTick;
+#ifdef dac_ldac_pulse
+static uint8_t dacLoaded;
+#endif
+
+// Sample-to-output latency, microseconds:
+static uint16_t dacTickTime;
+static volatile uint16_t dacLatency, dacLatencyMax;
+
+static void dacJobDone(struct spi_job *job);
+
+static void dacSelect(uint8_t select)
+{
+	if( select ) {
+		select_analog_out();
+	} else {
+		unselect_analog_out();
+	}
+}
 
 void dacLoadDefConst(uint16_t *dacConst)
 {
@@ -53,21 +83,123 @@ void lpcDacSet(unsigned char ch, unsigned int data, unsigned int d)
 
 void initDac(void)
 {
+	uint8_t i;
+
 	select_analog_out();
 	unselect_analog_out();
+
+	// f_OSC / 2:
+	spi_device_init( SPI_DEVICE_ANALOG_OUT, dacSelect, 0, (1<<SPI2X) );
+
+	for( i = 0; i < NUMBER_OF_DAC_CHANNEL; i++ ) {
+		dacJob[i].data = dacJobData[i];
+		dacJob[i].length = sizeof(dacJobData[i]);
+		dacJob[i].device = SPI_DEVICE_ANALOG_OUT;
+	}
+	dacJob[NUMBER_OF_DAC_CHANNEL - 1].done = dacJobDone;
+}
+
+/*
+	Sets the values written on the next servo tick by dacTick().
+	'nTick' is the servo tick of the sample they were computed from.
+*/
+void writeDac(uint16_t dac_a, uint16_t dac_b, uint32_t nTick)
+{
+	uint8_t sreg = SREG;
+
+	cli();
+	dacValue[0] = dac_a;
+	dacValue[1] = dac_b;
+	dacValueTick = nTick;
+	SREG = sreg;
 }
 
-void writeDac(uint16_t dac_a, uint16_t dac_b)
+/*
+	Records the latency of the values which just reached the outputs.
+	Interrupt context.
+*/
+static void dacOutput(uint32_t nTick)
 {
-	select_analog_out();
-	spi_send_byte(0x30);
-	spi_send_byte(dac_a>>8);
-	spi_send_byte(dac_a<<4);
-	unselect_analog_out();
+	uint32_t latency;
 
-	select_analog_out();
-	spi_send_byte(0x31);
-	spi_send_byte(dac_b>>8);
-	spi_send_byte(dac_b<<4);
-	unselect_analog_out();
+	if( nTick == dacOutTick ) {
+		return;
+	}
+	dacOutTick = nTick;
+
+	latency = (nServoTicks - nTick) * 1000 + (uint16_t)(timebase_now() - dacTickTime) / TIMEBASE_TICKS_PER_US;
+	if( latency > 0xffff ) {
+		latency = 0xffff;
+	}
+
+	dacLatency = latency;
+	if( dacLatency > dacLatencyMax ) {
+		dacLatencyMax = dacLatency;
+	}
+}
+
+// Runs in the SPI interrupt after the last channel:
+static void dacJobDone(struct spi_job *job)
+{
+#ifdef dac_ldac_pulse
+	dacLoaded = 1;
+#else
+	dacOutput( dacJobTick );
+#endif
+}
+
+/*
+	Called from TIMER2_COMP_vect once per servo tick, after nServoTicks
+	has been advanced. Both channels are queued in front of all other SPI
+	jobs. A running job or a blocking transaction of the network or SD
+	card driver is finished first, so the outputs change within the
+	longest of them after the tick (input register WORD_116, some 100us
+	for an ENC424J600 burst, about 0.6ms plus the card's access time
+	for an SD block).
+
+	With dac_ldac_pulse() defined the DAC is double buffered in hardware:
+	the values loaded during the last tick are latched right here, which
+	takes the SPI bus out of the timing at the cost of one more tick.
+*/
+void dacTick(void)
+{
+	uint8_t i;
+
+	dacTickTime = timebase_now();
+
+	if( dacJob[0].busy || dacJob[1].busy ) {
+		return;
+	}
+
+#ifdef dac_ldac_pulse
+	if( dacLoaded ) {
+		dacLoaded = 0;
+		dac_ldac_pulse();
+		dacOutput( dacJobTick );
+	}
+#endif
+
+	for( i = 0; i < NUMBER_OF_DAC_CHANNEL; i++ ) {
+		dacJobData[i][0] = 0x30 | i;
+		dacJobData[i][1] = dacValue[i]>>8;
+		dacJobData[i][2] = dacValue[i]<<4;
+	}
+	dacJobTick = dacValueTick;
+
+	// Urgent jobs go to the front, so queue channel 0 last:
+	spi_job_submit_urgent( &dacJob[1] );
+	spi_job_submit_urgent( &dacJob[0] );
+}
+
+/*
+	Returns the sample-to-output latency of the last update and the
+	largest one since the previous call, in microseconds.
+*/
+void dacGetLatency(uint16_t *lpLast, uint16_t *lpMax)
+{
+	cli();
+	*lpLast = dacLatency;
+	*lpMax = dacLatencyMax;
+	dacLatencyMax = dacLatency;
+	sei();
 }
@@ -30,4 +30,10 @@ void initDac(void);
 void dacLoadDefConst(uint16_t *dacConst);
 void lpcDacSet(unsigned char ch, unsigned int data, unsigned int d);
 
-void writeDac(uint16_t dac_a, uint16_t dac_b);
+// LDAC of the DAC, latches both channels. Tied low on this board, so the
+// outputs change with each write; define it to latch them from dacTick():
+//#define dac_ldac_pulse()				do { PORTG &= ~DAC_LDAC_bm; PORTG |= DAC_LDAC_bm; } while( 0 )
+
+void writeDac(uint16_t dac_a, uint16_t dac_b, uint32_t nTick);
+void dacTick(void);
+void dacGetLatency(uint16_t *lpLast, uint16_t *lpMax);
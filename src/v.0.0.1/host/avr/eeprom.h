@@ -0,0 +1,29 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <avr/eeprom.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* EEMEM variables live in RAM and are lost when the process exits */
+#define EEMEM
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+uint16_t eeprom_read_word(const uint16_t* addr);
+void eeprom_read_block(void* dst, const void* src, size_t n);
+void eeprom_update_byte(uint8_t* addr, uint8_t value);
+void eeprom_update_word(uint16_t* addr, uint16_t value);
+void eeprom_update_block(const void* src, void* dst, size_t n);
+
+#define eeprom_write_byte		eeprom_update_byte
+#define eeprom_write_word		eeprom_update_word
+#define eeprom_write_block		eeprom_update_block
+
+#endif
@@ -0,0 +1,18 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <avr/interrupt.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+/* the host build is single threaded and has no interrupts to mask */
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,71 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <avr/io.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+#include <stdint.h>
+
+/*
+ * The I/O registers which the shared headers touch are plain variables
+ * defined in host_stubs.c. Bit numbers follow the ATmega128 data sheet.
+ */
+extern volatile uint8_t SREG;
+extern volatile uint8_t SPCR;
+extern volatile uint8_t SPSR;
+extern volatile uint8_t SPDR;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t DDRB;
+extern volatile uint8_t PINB;
+
+#define SPIF	7
+#define WCOL	6
+#define SPI2X	0
+#define SPIE	7
+#define SPE		6
+#define DORD	5
+#define MSTR	4
+#define CPOL	3
+#define CPHA	2
+#define SPR1	1
+#define SPR0	0
+
+#define PB0		0
+#define PB1		1
+#define PB2		2
+#define PB3		3
+#define PB4		4
+#define PB5		5
+#define PB6		6
+#define PB7		7
+
+#define PD0		0
+#define PD1		1
+#define PD2		2
+#define PD3		3
+#define PD4		4
+#define PD5		5
+#define PD6		6
+#define PD7		7
+
+#define PE0		0
+#define PE1		1
+#define PE2		2
+#define PE3		3
+#define PE4		4
+#define PE5		5
+#define PE6		6
+#define PE7		7
+
+#define PG0		0
+#define PG1		1
+#define PG2		2
+#define PG3		3
+#define PG4		4
+
+#endif
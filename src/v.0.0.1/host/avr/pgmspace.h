@@ -0,0 +1,58 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <avr/pgmspace.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * The host has a single address space, so flash data is ordinary const
+ * data and the *_P functions are their RAM counterparts.
+ *
+ * pgm_read_word() is used on the board to fetch pointers from flash
+ * tables, which are 16 bits wide there but not here. It therefore reads
+ * an object of the pointed-to type instead of a fixed 16-bit word.
+ */
+#define PROGMEM
+#define PGM_P						const char*
+#define PSTR(s)						(s)
+
+#define pgm_read_byte(addr)			(*(const uint8_t*) (addr))
+#define pgm_read_word(addr)			(*(addr))
+#define pgm_read_dword(addr)		(*(const uint32_t*) (addr))
+#define pgm_read_byte_near(addr)	pgm_read_byte(addr)
+#define pgm_read_word_near(addr)	pgm_read_word(addr)
+
+#define memcpy_P					memcpy
+#define strcpy_P					strcpy
+#define strncpy_P					strncpy
+#define strcat_P					strcat
+#define strcmp_P					strcmp
+#define strncmp_P					strncmp
+#define strcasecmp_P				strcasecmp
+#define strncasecmp_P				strncasecmp
+#define strlen_P					strlen
+#define strchr_P					strchr
+#define strstr_P					strstr
+#define fputs_P						fputs
+#define puts_P						puts
+
+/* avr-libc takes %S for a string in flash, glibc for a wide string */
+int host_printf_P(const char* format, ...);
+int host_sprintf_P(char* s, const char* format, ...);
+int host_snprintf_P(char* s, size_t n, const char* format, ...);
+
+#define printf_P					host_printf_P
+#define sprintf_P					host_sprintf_P
+#define snprintf_P					host_snprintf_P
+
+#endif
@@ -0,0 +1,18 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <avr/wdt.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#define WDTO_2S			7
+
+#define wdt_enable(timeout)
+#define wdt_disable()
+#define wdt_reset()
+
+#endif
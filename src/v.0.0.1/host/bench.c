@@ -0,0 +1,341 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	load generator for the web server and Modbus TCP
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * mega-eth-bench http|modbus ADDRESS PORT [options]
+ *
+ *	-c N	number of concurrent clients, default 1
+ *	-t S	run time in seconds, default 10
+ *	-u URI	document to fetch in http mode, default /status.xml
+ *	-n N	input registers to read per Modbus request, default 16
+ *
+ * In http mode each client opens a connection, sends a GET request and
+ * reads until the server closes, as the server does not keep connections
+ * alive. In modbus mode each client keeps one connection and sends the
+ * next "read input registers" request as soon as the response is in.
+ *
+ * A request which fails or stalls for longer than two seconds counts as
+ * an error and is not part of the latency figures.
+ */
+
+#define BENCH_TIMEOUT_S			2
+#define BENCH_MAX_CLIENTS		16
+#define BENCH_MAX_SAMPLES		(1UL << 20)
+
+enum bench_mode
+{
+	BENCH_HTTP,
+	BENCH_MODBUS
+};
+
+struct bench_client
+{
+	pthread_t thread;
+	unsigned long requests;
+	unsigned long errors;
+	unsigned long long bytes;
+	unsigned long samples_len;
+	uint32_t* samples;		// latency of each request in microseconds
+};
+
+static enum bench_mode benchMode;
+static struct sockaddr_in benchAddr;
+static const char* benchUri = "/status.xml";
+static unsigned int benchRegisters = 16;
+static double benchEnd;
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bench_connect(void)
+{
+	struct timeval tv = { BENCH_TIMEOUT_S, 0 };
+	int one = 1;
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if( fd < 0 ) {
+		return -1;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if( connect(fd, (struct sockaddr*) &benchAddr, sizeof(benchAddr)) ) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int bench_send_all(int fd, const uint8_t* data, size_t len)
+{
+	while( len ) {
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+		if( n <= 0 ) {
+			return -1;
+		}
+		data += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+static int bench_recv_all(int fd, uint8_t* buffer, size_t len)
+{
+	while( len ) {
+		ssize_t n = recv(fd, buffer, len, 0);
+		if( n <= 0 ) {
+			return -1;
+		}
+		buffer += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+// One GET request, returns the number of bytes received or -1:
+static long bench_http_request(void)
+{
+	char request[256];
+	uint8_t buffer[4096];
+	long received = 0;
+	bool status_ok = false;
+	ssize_t n;
+	int fd;
+
+	fd = bench_connect();
+	if( fd < 0 ) {
+		return -1;
+	}
+
+	snprintf(request, sizeof(request), "GET %s HTTP/1.0\r\n\r\n", benchUri);
+	if( bench_send_all(fd, (const uint8_t*) request, strlen(request)) ) {
+		close(fd);
+		return -1;
+	}
+
+	while( (n = recv(fd, buffer, sizeof(buffer), 0)) > 0 ) {
+		if( !received ) {
+			status_ok = n >= 12 && !memcmp(buffer, "HTTP/1.", 7) && '2' == buffer[9];
+		}
+		received += n;
+	}
+
+	close(fd);
+	if( n < 0 || !status_ok ) {
+		return -1;
+	}
+
+	return received;
+}
+
+// One "read input registers" transaction, returns the response size or -1:
+static long bench_modbus_request(int fd, uint16_t transaction)
+{
+	uint8_t request[12];
+	uint8_t response[9 + 2 * 125];
+	size_t response_len = 9 + 2 * benchRegisters;
+
+	request[0] = transaction >> 8;
+	request[1] = transaction;
+	request[2] = 0;					// protocol
+	request[3] = 0;
+	request[4] = 0;					// length
+	request[5] = 6;
+	request[6] = 1;					// unit
+	request[7] = 4;					// read input registers
+	request[8] = 0;					// first register
+	request[9] = 0;
+	request[10] = benchRegisters >> 8;
+	request[11] = benchRegisters;
+
+	if( bench_send_all(fd, request, sizeof(request)) ||
+		bench_recv_all(fd, response, response_len) ||
+		memcmp(response, request, 2) || 4 != response[7]
+	) {
+		return -1;
+	}
+
+	return response_len;
+}
+
+static void* bench_client_run(void* arg)
+{
+	struct bench_client* client = arg;
+	uint16_t transaction = 0;
+	int fd = -1;
+
+	while( bench_now() < benchEnd ) {
+		double start;
+		long n;
+
+		if( BENCH_MODBUS == benchMode && fd < 0 ) {
+			fd = bench_connect();
+			if( fd < 0 ) {
+				struct timespec backoff = { 0, 100000000 };
+
+				++client->errors;
+				nanosleep(&backoff, 0);
+				continue;
+			}
+		}
+
+		start = bench_now();
+		n = BENCH_HTTP == benchMode ? bench_http_request() : bench_modbus_request(fd, ++transaction);
+		if( n < 0 ) {
+			++client->errors;
+			if( fd >= 0 ) {
+				close(fd);
+				fd = -1;
+			}
+			continue;
+		}
+
+		++client->requests;
+		client->bytes += n;
+		if( client->samples_len < BENCH_MAX_SAMPLES ) {
+			client->samples[client->samples_len++] = (bench_now() - start) * 1e6;
+		}
+	}
+
+	if( fd >= 0 ) {
+		close(fd);
+	}
+
+	return 0;
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+	uint32_t x = *(const uint32_t*) a;
+	uint32_t y = *(const uint32_t*) b;
+
+	return (x > y) - (x < y);
+}
+
+static void bench_usage(void)
+{
+	fprintf(stderr, "usage: mega-eth-bench http|modbus ADDRESS PORT [-c clients] [-t seconds] [-u uri] [-n registers]\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv)
+{
+	static struct bench_client clients[BENCH_MAX_CLIENTS];
+	unsigned int client_count = 1;
+	unsigned long requests = 0, errors = 0, samples_len = 0, i;
+	unsigned long long bytes = 0;
+	uint32_t* samples;
+	double seconds = 10;
+	double start, elapsed;
+
+	if( argc < 4 ) {
+		bench_usage();
+	}
+
+	if( !strcmp(argv[1], "http") ) {
+		benchMode = BENCH_HTTP;
+	} else if( !strcmp(argv[1], "modbus") ) {
+		benchMode = BENCH_MODBUS;
+	} else {
+		bench_usage();
+	}
+
+	memset(&benchAddr, 0, sizeof(benchAddr));
+	benchAddr.sin_family = AF_INET;
+	benchAddr.sin_port = htons(atoi(argv[3]));
+	if( 1 != inet_pton(AF_INET, argv[2], &benchAddr.sin_addr) ) {
+		bench_usage();
+	}
+
+	for( i = 4; i + 1 < (unsigned long) argc; i += 2 ) {
+		if( !strcmp(argv[i], "-c") ) {
+			client_count = atoi(argv[i + 1]);
+		} else if( !strcmp(argv[i], "-t") ) {
+			seconds = atof(argv[i + 1]);
+		} else if( !strcmp(argv[i], "-u") ) {
+			benchUri = argv[i + 1];
+		} else if( !strcmp(argv[i], "-n") ) {
+			benchRegisters = atoi(argv[i + 1]);
+		} else {
+			bench_usage();
+		}
+	}
+	if( i != (unsigned long) argc || !client_count || client_count > BENCH_MAX_CLIENTS ||
+		!benchRegisters || benchRegisters > 125
+	) {
+		bench_usage();
+	}
+
+	start = bench_now();
+	benchEnd = start + seconds;
+	for( i = 0; i < client_count; ++i ) {
+		clients[i].samples = malloc(BENCH_MAX_SAMPLES * sizeof(uint32_t));
+		if( !clients[i].samples || pthread_create(&clients[i].thread, 0, bench_client_run, &clients[i]) ) {
+			fprintf(stderr, "cannot start client %lu\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for( i = 0; i < client_count; ++i ) {
+		pthread_join(clients[i].thread, 0);
+		requests += clients[i].requests;
+		errors += clients[i].errors;
+		bytes += clients[i].bytes;
+		samples_len += clients[i].samples_len;
+	}
+	elapsed = bench_now() - start;
+
+	samples = malloc((samples_len + 1) * sizeof(uint32_t));
+	if( !samples ) {
+		return EXIT_FAILURE;
+	}
+	samples_len = 0;
+	for( i = 0; i < client_count; ++i ) {
+		memcpy(samples + samples_len, clients[i].samples, clients[i].samples_len * sizeof(uint32_t));
+		samples_len += clients[i].samples_len;
+	}
+	qsort(samples, samples_len, sizeof(uint32_t), bench_compare);
+
+	printf("requests:   %lu (%lu errors) in %.2f s\n", requests, errors, elapsed);
+	printf("requests/s: %.1f\n", requests / elapsed);
+	printf("bytes/s:    %.0f\n", bytes / elapsed);
+	if( samples_len ) {
+		printf("latency us: p50 %u  p99 %u  max %u\n",
+			samples[samples_len / 2],
+			samples[samples_len * 99 / 100],
+			samples[samples_len - 1]
+		);
+	}
+
+	return errors && !requests ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	case sensitive alias of app/CLOCK_SYNC_CONFIG.H
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "../app/CLOCK_SYNC_CONFIG.H"
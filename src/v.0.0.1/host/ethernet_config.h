@@ -0,0 +1,9 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	case sensitive alias of net/ETHERNET_CONFIG.H
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "../net/ETHERNET_CONFIG.H"
@@ -0,0 +1,112 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	network stack of the board as a Linux process
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../app/httpd.h"
+#include "../net/arp.h"
+#include "../net/ethernet.h"
+#include "../net/hal.h"
+#include "../net/icmp.h"
+#include "../net/ip.h"
+#include "../net/net_stats.h"
+#include "../net/tcp.h"
+#include "../net/udp.h"
+#include "../prof/prof.h"
+#include "../sys/timer.h"
+
+#include "mb.h"
+
+/*
+ * Runs the protocol stack, the web server on port 88 and Modbus TCP on
+ * port 502 on a TAP interface, with the address the board uses without
+ * DHCP. The interface has to carry the gateway address, e.g.
+ *
+ *	ip tuntap add tap0 mode tap
+ *	ip addr add 10.0.2.1/24 dev tap0
+ *	ip link set tap0 up
+ *
+ * The loop polls instead of sleeping, so the latencies measured against
+ * it are those of the stack and not of the host scheduler. On SIGINT or
+ * SIGTERM the network statistics are printed before exiting.
+ */
+
+static const uint8_t mac_addr[6] = { 'F', 'O', 'O', 'B', 'A', 'R' };
+static volatile sig_atomic_t hostStop;
+
+static void host_stop(int signal)
+{
+	(void) signal;
+	hostStop = 1;
+}
+
+static uint32_t host_millis(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int main(void)
+{
+	uint8_t ip_addr[4] = { 10, 0, 2, 76 };
+	uint8_t netmask[4] = { 255, 255, 255, 0 };
+	uint8_t gateway[4] = { 10, 0, 2, 1 };
+	const uint16_t* stats;
+	uint32_t tick;
+	uint8_t i;
+
+	net_stats_init();
+	if( !hal_init(mac_addr) ) {
+		return EXIT_FAILURE;
+	}
+
+	ethernet_init(mac_addr);
+	arp_init();
+	ip_init(ip_addr, netmask, gateway);
+	icmp_init();
+	tcp_init();
+	udp_init();
+
+	profInit();
+	httpd_init(88);
+
+	if( MB_ENOERR != eMBTCPInit(502) || MB_ENOERR != eMBEnable() ) {
+		fprintf(stderr, "modbus init failed\n");
+		return EXIT_FAILURE;
+	}
+
+	signal(SIGINT, host_stop);
+	signal(SIGTERM, host_stop);
+
+	tick = host_millis();
+	while( !hostStop ) {
+		// Catch up on the timer ticks the board counts in TIMER2_COMP_vect:
+		while( (int32_t) (host_millis() - tick) >= TIMER_MS_PER_TICK ) {
+			tick += TIMER_MS_PER_TICK;
+			timer_interval();
+		}
+
+		while( ethernet_handle_packet() );
+
+		eMBPoll();
+	}
+
+	stats = net_stats_get();
+	for( i = 0; i < NET_STAT_COUNT; ++i ) {
+		if( stats[i] ) {
+			printf_P(PSTR("%S %u\n"), net_stats_get_name(i), stats[i]);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,594 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	board services replaced for the host build
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <dirent.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "../arch/spi.h"
+#include "../arch/timebase.h"
+#include "../calib/calib.h"
+#include "../sd/fat16.h"
+#include "../sd/sd.h"
+#include "../ServoController/encoder.h"
+
+#include "mb.h"
+#include "mbport.h"
+#include "mbutils.h"
+
+/*
+ * The environment variable naming the directory which stands in for the
+ * root of the memory card, served below /sd/. Without it there is no card.
+ */
+#define HOST_ENV_SD_ROOT "HOST_SD_ROOT"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// I/O registers:
+volatile uint8_t SREG;
+volatile uint8_t SPCR;
+volatile uint8_t SPSR;
+volatile uint8_t SPDR;
+volatile uint8_t PORTB;
+volatile uint8_t DDRB;
+volatile uint8_t PINB;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Globals of main.c read by the web server:
+volatile uint8_t inPort[16], outPort[12];
+uint16_t arrDAC[2];
+
+#define REG_DISC_START							1
+#define REG_DISC_SIZE							32
+#define REG_COILS_START							1
+#define REG_COILS_SIZE							32
+#define REG_INPUT_START							1
+#define REG_INPUT_NREGS							117
+#define REG_HOLDING_START						1
+#define REG_HOLDING_NREGS						100
+
+unsigned char ucRegDiscBuf[REG_DISC_SIZE / 8];
+uint8_t ucRegCoilsBuf[REG_COILS_SIZE / 8];
+uint16_t uiRegInputBuf[REG_INPUT_NREGS];
+uint16_t uiRegHolding[REG_HOLDING_NREGS];
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// avr-libc:
+static int host_vsprintf_P(char* s, size_t n, const char* format, va_list args)
+{
+	char host_format[256];
+	size_t i;
+
+	// Flash and RAM strings are the same here, so %S becomes %s:
+	for( i = 0; format[i] && i < sizeof(host_format) - 1; ++i ) {
+		host_format[i] = format[i];
+		if( 'S' == format[i] && i && '%' == format[i - 1] ) {
+			host_format[i] = 's';
+		}
+	}
+	host_format[i] = '\0';
+
+	return s ? vsnprintf(s, n, host_format, args) : vprintf(host_format, args);
+}
+
+int host_printf_P(const char* format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = host_vsprintf_P(0, 0, format, args);
+	va_end(args);
+	return n;
+}
+
+int host_sprintf_P(char* s, const char* format, ...)
+{
+	va_list args;
+	int n;
+
+	va_start(args, format);
+	n = host_vsprintf_P(s, (size_t) -1 >> 1, format, args);
+	va_end(args);
+	return n;
+}
+
+int host_snprintf_P(char* s, size_t n, const char* format, ...)
+{
+	va_list args;
+	int written;
+
+	va_start(args, format);
+	written = host_vsprintf_P(s, n, format, args);
+	va_end(args);
+	return written;
+}
+
+uint8_t eeprom_read_byte(const uint8_t* addr)
+{
+	return *addr;
+}
+
+uint16_t eeprom_read_word(const uint16_t* addr)
+{
+	return *addr;
+}
+
+void eeprom_read_block(void* dst, const void* src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+void eeprom_update_byte(uint8_t* addr, uint8_t value)
+{
+	*addr = value;
+}
+
+void eeprom_update_word(uint16_t* addr, uint16_t value)
+{
+	*addr = value;
+}
+
+void eeprom_update_block(const void* src, void* dst, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+void _delay_us(double us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us - ts.tv_sec * 1000000.0) * 1000;
+	nanosleep(&ts, 0);
+}
+
+void _delay_ms(double ms)
+{
+	_delay_us(ms * 1000);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Timebase, at the tick rate of Timer3 on the board:
+void timebase_init()
+{
+}
+
+uint32_t timebase_now32()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t) ((uint64_t) ts.tv_sec * 1000000 * TIMEBASE_TICKS_PER_US + ts.tv_nsec * TIMEBASE_TICKS_PER_US / 1000);
+}
+
+uint16_t timebase_now()
+{
+	return timebase_now32();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SPI bus without devices, MISO reads as pulled up:
+static struct spi_stats spiStats[SPI_MAX_DEVICES + 1];
+
+void spi_init()
+{
+}
+
+void spi_send_byte(uint8_t b)
+{
+	(void) b;
+}
+
+uint8_t spi_rec_byte()
+{
+	return 0xff;
+}
+
+void spi_send_data(const uint8_t* data, uint16_t data_len)
+{
+	(void) data;
+	(void) data_len;
+}
+
+void spi_rec_data(uint8_t* buffer, uint16_t buffer_len)
+{
+	memset(buffer, 0xff, buffer_len);
+}
+
+void spi_low_frequency()
+{
+}
+
+void spi_high_frequency()
+{
+}
+
+void spi_bus_lock()
+{
+	++spiStats[SPI_STATS_BLOCKING].jobs;
+}
+
+void spi_bus_unlock()
+{
+}
+
+void spi_device_init(uint8_t device, spi_select_callback select, uint8_t spcr, uint8_t spsr)
+{
+	(void) device;
+	(void) select;
+	(void) spcr;
+	(void) spsr;
+}
+
+uint8_t spi_job_submit(struct spi_job* job)
+{
+	if( !job || !job->length || job->device >= SPI_MAX_DEVICES ) {
+		return 0;
+	}
+
+	++spiStats[job->device].jobs;
+	spiStats[job->device].bytes += job->length;
+	memset(job->data, 0xff, job->length);
+	job->busy = 0;
+	if( job->done ) {
+		job->done(job);
+	}
+
+	return 1;
+}
+
+uint8_t spi_job_submit_urgent(struct spi_job* job)
+{
+	return spi_job_submit(job);
+}
+
+void spi_job_wait(const struct spi_job* job)
+{
+	(void) job;
+}
+
+void spi_get_stats(uint8_t index, struct spi_stats* stats)
+{
+	*stats = spiStats[index];
+}
+
+void spi_reset_max_time(uint8_t index)
+{
+	spiStats[index].max_time = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Memory card, a host directory named by HOST_SD_ROOT:
+struct fat16_fs_struct
+{
+	char root[256];
+};
+
+struct fat16_file_struct
+{
+	FILE* file;
+};
+
+struct fat16_dir_struct
+{
+	DIR* dir;
+	char path[512];
+};
+
+static struct fat16_fs_struct hostFs;
+
+struct fat16_fs_struct* sd_get_fs()
+{
+	const char* root = getenv(HOST_ENV_SD_ROOT);
+
+	if( !root ) {
+		return 0;
+	}
+
+	snprintf(hostFs.root, sizeof(hostFs.root), "%s", root);
+	return &hostFs;
+}
+
+static uint8_t host_fill_dir_entry(const char* path, const char* name, struct fat16_dir_entry_struct* dir_entry)
+{
+	struct stat st;
+
+	if( stat(path, &st) ) {
+		return 0;
+	}
+
+	memset(dir_entry, 0, sizeof(*dir_entry));
+	snprintf(dir_entry->long_name, sizeof(dir_entry->long_name), "%s", name);
+	dir_entry->attributes = S_ISDIR(st.st_mode) ? FAT16_ATTRIB_DIR : 0;
+	dir_entry->file_size = st.st_size;
+
+	return 1;
+}
+
+/* The entry offset, unused by the card driver here, stores the index into this table. */
+static char hostPaths[8][512];
+static uint8_t hostPathNext;
+
+uint8_t fat16_get_dir_entry_of_path(struct fat16_fs_struct* fs, const char* path, struct fat16_dir_entry_struct* dir_entry)
+{
+	const char* name;
+	char* slot;
+
+	if( !fs || !path || strstr(path, "..") ) {
+		return 0;
+	}
+
+	slot = hostPaths[hostPathNext];
+	snprintf(slot, sizeof(hostPaths[0]), "%s%s", fs->root, path);
+	name = strrchr(path, '/');
+	if( !host_fill_dir_entry(slot, name ? name + 1 : path, dir_entry) ) {
+		return 0;
+	}
+
+	dir_entry->entry_offset = hostPathNext;
+	hostPathNext = (hostPathNext + 1) % (sizeof(hostPaths) / sizeof(hostPaths[0]));
+
+	return 1;
+}
+
+struct fat16_file_struct* fat16_open_file(struct fat16_fs_struct* fs, const struct fat16_dir_entry_struct* dir_entry)
+{
+	struct fat16_file_struct* fd;
+	FILE* file;
+
+	if( !fs || (dir_entry->attributes & FAT16_ATTRIB_DIR) ) {
+		return 0;
+	}
+
+	file = fopen(hostPaths[dir_entry->entry_offset], "rb");
+	if( !file ) {
+		return 0;
+	}
+
+	fd = malloc(sizeof(*fd));
+	if( !fd ) {
+		fclose(file);
+		return 0;
+	}
+
+	fd->file = file;
+	return fd;
+}
+
+void fat16_close_file(struct fat16_file_struct* fd)
+{
+	if( fd ) {
+		fclose(fd->file);
+		free(fd);
+	}
+}
+
+int16_t fat16_read_file(struct fat16_file_struct* fd, uint8_t* buffer, uint16_t buffer_len)
+{
+	if( buffer_len > INT16_MAX ) {
+		buffer_len = INT16_MAX;
+	}
+
+	return fread(buffer, 1, buffer_len, fd->file);
+}
+
+struct fat16_dir_struct* fat16_open_dir(struct fat16_fs_struct* fs, const struct fat16_dir_entry_struct* dir_entry)
+{
+	struct fat16_dir_struct* dd;
+
+	if( !fs || !(dir_entry->attributes & FAT16_ATTRIB_DIR) ) {
+		return 0;
+	}
+
+	dd = malloc(sizeof(*dd));
+	if( !dd ) {
+		return 0;
+	}
+
+	snprintf(dd->path, sizeof(dd->path), "%s", hostPaths[dir_entry->entry_offset]);
+	dd->dir = opendir(dd->path);
+	if( !dd->dir ) {
+		free(dd);
+		return 0;
+	}
+
+	return dd;
+}
+
+void fat16_close_dir(struct fat16_dir_struct* dd)
+{
+	if( dd ) {
+		closedir(dd->dir);
+		free(dd);
+	}
+}
+
+uint8_t fat16_read_dir(struct fat16_dir_struct* dd, struct fat16_dir_entry_struct* dir_entry)
+{
+	struct dirent* entry;
+	char path[1024];
+
+	while( (entry = readdir(dd->dir)) ) {
+		if( '.' == entry->d_name[0] ) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/%s", dd->path, entry->d_name);
+		if( host_fill_dir_entry(path, entry->d_name, dir_entry) ) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Servo side:
+void encoderGetSnapshot( LP_ENCODER_SNAPSHOT lpSnapshot )
+{
+	memset(lpSnapshot, 0, sizeof(*lpSnapshot));
+}
+
+int16_t calibAdcToCentiDegree(uint16_t counts)
+{
+	return counts;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Modbus RTU port, the host only serves Modbus TCP:
+void vMBPortSerialEnable( BOOL xRxEnable, BOOL xTxEnable )
+{
+	(void) xRxEnable;
+	(void) xTxEnable;
+}
+
+BOOL xMBPortSerialInit( UCHAR ucPORT, ULONG ulBaudRate, UCHAR ucDataBits, eMBParity eParity )
+{
+	(void) ucPORT;
+	(void) ulBaudRate;
+	(void) ucDataBits;
+	(void) eParity;
+	return FALSE;
+}
+
+BOOL xMBPortSerialPutByte( CHAR ucByte )
+{
+	(void) ucByte;
+	return FALSE;
+}
+
+BOOL xMBPortSerialGetByte( CHAR * pucByte )
+{
+	(void) pucByte;
+	return FALSE;
+}
+
+BOOL xMBPortTimersInit( USHORT usTim1Timerout50us )
+{
+	(void) usTim1Timerout50us;
+	return FALSE;
+}
+
+void vMBPortTimersEnable( void )
+{
+}
+
+void vMBPortTimersDisable( void )
+{
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Modbus registers, as in main.c without the side effects on the servo:
+eMBErrorCode eMBRegDiscreteCB(UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete)
+{
+	short iNDiscrete = ( short )usNDiscrete;
+	unsigned short usBitOffset;
+
+	if( (usAddress >= REG_DISC_START) &&
+		(usAddress + usNDiscrete <= REG_DISC_START + REG_DISC_SIZE)
+	) {
+		usBitOffset = ( unsigned short )( usAddress - REG_DISC_START );
+		while(iNDiscrete > 0) {
+			*pucRegBuffer++ =
+			xMBUtilGetBits( ucRegDiscBuf, usBitOffset,
+                            (unsigned char)(iNDiscrete>8? 8:iNDiscrete)
+			);
+			iNDiscrete -= 8;
+			usBitOffset += 8;
+		}
+		return MB_ENOERR;
+	}
+
+	return MB_ENOREG;
+}
+
+eMBErrorCode eMBRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
+							USHORT usNCoils, eMBRegisterMode eMode
+						  )
+{
+	short iNCoils = ( short )usNCoils;
+	unsigned short usBitOffset;
+
+	if( (usAddress >= REG_COILS_START) &&
+		(usAddress + usNCoils <= REG_COILS_START + REG_COILS_SIZE)
+	) {
+		usBitOffset = (unsigned short)(usAddress - REG_COILS_START);
+		while( iNCoils > 0 ) {
+			if( MB_REG_READ == eMode ) {
+				*pucRegBuffer++ =
+				xMBUtilGetBits( ucRegCoilsBuf, usBitOffset,
+								(unsigned char)((iNCoils > 8) ? 8 : iNCoils)
+				);
+			} else {
+				xMBUtilSetBits( ucRegCoilsBuf, usBitOffset,
+								(unsigned char)((iNCoils > 8) ? 8 : iNCoils),
+								*pucRegBuffer++
+				);
+			}
+			usBitOffset += 8;
+			iNCoils -= 8;
+		}
+		return MB_ENOERR;
+	}
+
+	return MB_ENOREG;
+}
+
+eMBErrorCode eMBRegInputCB(UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNRegs)
+{
+	unsigned int iRegIndex;
+
+	if( (usAddress >= REG_INPUT_START) &&
+		(usAddress + usNRegs <= REG_INPUT_START + REG_INPUT_NREGS)
+	) {
+		iRegIndex = (int)(usAddress - REG_INPUT_START);
+		while( usNRegs > 0 ) {
+			*pucRegBuffer++ = (unsigned char)(uiRegInputBuf[iRegIndex] >> 8);
+			*pucRegBuffer++ = (unsigned char)(uiRegInputBuf[iRegIndex] & 0xFF);
+			++iRegIndex;
+			--usNRegs;
+		}
+		return MB_ENOERR;
+	}
+	return MB_ENOREG;
+}
+
+eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
+							  USHORT usNRegs, eMBRegisterMode eMode
+)
+{
+	unsigned int iRegIndex;
+
+	if( (usAddress >= REG_HOLDING_START) &&
+		(usAddress + usNRegs <= REG_HOLDING_START + REG_HOLDING_NREGS)
+	) {
+		iRegIndex = (int)(usAddress - REG_HOLDING_START);
+		while( usNRegs > 0 ) {
+			if( MB_REG_READ == eMode ) {
+				*pucRegBuffer++ = uiRegHolding[iRegIndex]>>8;
+				*pucRegBuffer++ = uiRegHolding[iRegIndex];
+			} else {
+				uiRegHolding[iRegIndex]  = (*pucRegBuffer++)<<8;
+				uiRegHolding[iRegIndex] |= *pucRegBuffer++;
+			}
+			++iRegIndex;
+			--usNRegs;
+		}
+		return MB_ENOERR;
+	}
+
+	return MB_ENOREG;
+}
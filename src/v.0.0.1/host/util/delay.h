@@ -0,0 +1,15 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:	host replacement of <util/delay.h>
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+void _delay_us(double us);
+void _delay_ms(double ms);
+
+#endif
@@ -206,13 +206,38 @@ uint8_t ucRegCoilsBuf[REG_COILS_SIZE / 8];
 	-----------------------------------------------------------------------------------------
 	WORD_18[36:37]:	[LSB:MSB] - MSB: DIP8 Switch
 	-----------------------------------------------------------------------------------------
-	WORD_19[38:39]: [LSB0:MSB1] Optical Encoder COUNTER
-	WORD_20[40:41]: [LSB2:MSB3] Optical Encoder COUNTER
+	WORD_19..25:	Servo tick (low 16 bits) at which analog input 0..6 was converted
+	WORD_26..32:	Filtered analog input 0..6, 12-bit counts * 16 (see adc/adc_filter.h)
+	WORD_33..38:	SPI bus load over the last second, 0.1% units: devices SPI_DEVICE_*
+					(main.h), blocking transfers of the network and SD card drivers
+	-----------------------------------------------------------------------------------------
+	WORD_39..40:	Encoder snapshot: position (int32, LSW first)
+	WORD_41..42:	Encoder snapshot: velocity, counts per servo tick (int32, LSW first)
+	WORD_43..44:	Encoder snapshot: servo tick of the sample (uint32, LSW first)
+	-----------------------------------------------------------------------------------------
+	WORD_45:		DAC sample-to-output latency of the last update, us, refreshed every second
+	WORD_46:		DAC sample-to-output latency, maximum over the last second, us
+	-----------------------------------------------------------------------------------------
+	WORD_47:		Servo ticks skipped because the previous one was still running
+	WORD_48:		Servo tick execution time, maximum over the last second, us
+	WORD_49:		Servo tick execution time, maximum since reset, us
+	-----------------------------------------------------------------------------------------
+	WORD_50:		Main loop passes over the last second
+	WORD_51..77:	Main loop stage time over the last second, us: min, avg, max for each
+					of the stages PROF_STAGE_* (prof/prof.h)
+	-----------------------------------------------------------------------------------------
+	WORD_78..109:	Network event counters NET_STAT_* (net/net_stats.h), in enum order,
+					wrapping around, refreshed every second
+	WORD_110..115:	TCP receive path bytes: received, queued, read in place
+					(uint32 each, LSW first, see struct tcp_rx_stats in net/tcp.h)
+	-----------------------------------------------------------------------------------------
+	WORD_116:		Longest blocking SPI transaction of the network and SD card drivers
+					over the last second, us (bounds the extra DAC latency, WORD_46)
 	-----------------------------------------------------------------------------------------
 */
 // MB_FUNC_READ_INPUT_REGISTER					(  4 )
 #define REG_INPUT_START							1
-#define REG_INPUT_NREGS							50
+#define REG_INPUT_NREGS							117
 
 uint16_t uiRegInputBuf[REG_INPUT_NREGS];
 uint8_t usRegInputStart = REG_INPUT_START;
@@ -293,6 +318,9 @@ uint8_t usRegInputStart = REG_INPUT_START;
 	-----------------------------------------------------------------------------------------
 	WORD_21[44:45]:	[LSB:MSB];      EEPROM
 	-----------------------------------------------------------------------------------------
+	WORD_22..28:	Filter configuration of analog input 0..6 (see adc/adc_filter.h),
+					default / load / save together with the ADC constants (WORD_14)
+	-----------------------------------------------------------------------------------------
 */
 // MB_FUNC_WRITE_REGISTER						( 6 )
 // MB_FUNC_READ_HOLDING_REGISTER				( 3 )
@@ -307,11 +335,21 @@ uint16_t uiRegHolding[REG_HOLDING_NREGS];
 extern volatile uint8_t bDoPID;
 extern volatile int16_t nMaxPidOut;
 extern volatile int32_t nEncoderPosition;
+extern volatile uint32_t nServoTicks;
 
 /* --------------------------------- Static variables ------------------------------------ */
 static volatile bool net_link_up = 0;
 static volatile uint16_t timer_events = 0;
+static char rs485_address_switch_old = 0;
+static struct fat16_dir_struct* sd_root_dir = 0;
 static volatile int32_t nEncoderPositionOld = 0;
+static uint32_t nSpiLoadTick = 0;
+
+// Servo tick executor, see servoTick():
+static volatile uint8_t bServoBusy = 0;
+static volatile uint8_t bServoReverse = 0;
+static volatile uint16_t nServoOverruns = 0;
+static volatile uint16_t nServoTime = 0, nServoTimeMax = 0, nServoTimeWorst = 0;
 
 /* --------------------------------- Other varitables ------------------------------------ */
 volatile uint8_t mac_addr[6] = { 'F', 'O', 'O', 'B', 'A', 'R' };
@@ -334,6 +372,7 @@ EEMEM uint8_t firstRunEEPROM;
 EEMEM uint8_t isRunEEPROM;
 
 EEMEM uint16_t arrADCConstEEPROM[7];
+EEMEM uint16_t arrADCFilterEEPROM[7];
 EEMEM uint16_t arrDACConstEEPROM[2];
 EEMEM uint32_t analogControlWordEEPROM;
 
@@ -343,6 +382,10 @@ EEMEM uint16_t uiModBusTimeOutEEPROM;
 
 /* ------------------------------- Start implementation ---------------------------------- */
 static void dhcp_client_event_callback(enum dhcp_client_event event);
+static void servoTick(uint32_t nTick);
+static void servoLock(void);
+static void servoUnlock(void);
+static void initTasks(void);
 
 int main()
 {
@@ -405,8 +448,6 @@ int main()
 		}
 	}
 
-	char rs485_address_switch_old = 0;
-	struct fat16_dir_struct* dir = 0;
 	int i, n = 0;
 	char fb = 0;
 
@@ -451,11 +492,15 @@ int main()
 	uart_connect_stdio();
 	printf_P( PSTR("mega-eth booting...\n") );*/
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	timebase_init();
 	spi_init();
 	initAddressSwitch();
 	initDigitalInput((uint8_t*)inPort);
 	initDigitalOutput((uint8_t*)outPort);
+	initAdc();
+	initDac();
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	net_stats_init();
 	hal_init((unsigned char*)mac_addr);
 	// initialize ethernet protocol stack
 	ethernet_init((unsigned char*)mac_addr);
@@ -477,6 +522,7 @@ int main()
 
 		//uartLoadDefConst();
 		adcLoadDefConst( &uiRegHolding[5] );
+		adcFilterLoadDefConst( &uiRegHolding[22] );
 
 		uiRegHolding[14] = 0x0f<<8;
 		dacLoadDefConst(&uiRegHolding[12]);
@@ -490,6 +536,7 @@ int main()
 
 		eeprom_update_word((void*)&analogControlWordEEPROM, uiRegHolding[14]);
 		eeprom_update_block((void*)&uiRegHolding[5], (void*)&arrADCConstEEPROM, sizeof(arrADCConstEEPROM));
+		eeprom_update_block((void*)&uiRegHolding[22], (void*)&arrADCFilterEEPROM, sizeof(arrADCFilterEEPROM));
 		eeprom_update_block((void*)&uiRegHolding[12], (void*)&arrDACConstEEPROM, sizeof(arrDACConstEEPROM));
 
 		//if(PROGPIN & (1<<PROG_NO)) {
@@ -506,9 +553,12 @@ int main()
 		uiRegHolding[18] = eeprom_read_word((void*)&uiModBusTimeOutEEPROM);
 
 		eeprom_read_block((void*)&uiRegHolding[5], (void*)&arrADCConstEEPROM, sizeof(arrADCConstEEPROM));
+		eeprom_read_block((void*)&uiRegHolding[22], (void*)&arrADCFilterEEPROM, sizeof(arrADCFilterEEPROM));
 		eeprom_read_block((void*)&uiRegHolding[12], (void*)&arrDACConstEEPROM, sizeof(arrDACConstEEPROM));
 		eeprom_read_block((void*)&uiRegHolding[14], (void*)&analogControlWordEEPROM, sizeof(*uiRegHolding));
 	}
+	adcFilterSetupAll( &uiRegHolding[22] );
+	calibInit( &uiRegHolding[5], &uiRegHolding[12] );
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// setup interval timer
 	TCCR2 |= (1<<WGM21) | (0<<WGM20) | (1<<CS22) | (0<<CS21) | (1<<CS20);
@@ -519,9 +569,15 @@ int main()
 	// start clock
 	clock_init();
 
+	// sample the analog inputs in the background
+	adcSequencerStart( ADC_SAMPLE_TICKS );
+
 	// start http server
 	httpd_init(88);
 
+	// publish the servo state over UDP
+	telemetryInit();
+
 	int eStatus;
 	eStatus = eMBTCPInit(502);
 	//eStatus = eMBInit( MB_RTU, 10, 0, 115200, MB_PAR_EVEN );
@@ -558,6 +614,8 @@ int main()
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	servoInit( );
 	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	profInit( );
+	initTasks( );
 
 	while( 1 ) {
 		wdt_reset();
@@ -571,6 +629,9 @@ int main()
 			if(0x0020 & uiRegHolding[14]) {
 				uiRegHolding[14] &= ~0x0020;
 				adcLoadDefConst(&uiRegHolding[5]);
+				adcFilterLoadDefConst(&uiRegHolding[22]);
+				adcFilterSetupAll(&uiRegHolding[22]);
+				calibInit(&uiRegHolding[5], &uiRegHolding[12]);
 			}
 
 			//  ,   
@@ -578,6 +639,9 @@ int main()
 			if(0x0040 & uiRegHolding[14]) {
 				uiRegHolding[14] &= ~0x0040;
 				eeprom_read_block((void*)&uiRegHolding[5], (void*)&arrADCConstEEPROM, sizeof(arrADCConstEEPROM));
+				eeprom_read_block((void*)&uiRegHolding[22], (void*)&arrADCFilterEEPROM, sizeof(arrADCFilterEEPROM));
+				adcFilterSetupAll(&uiRegHolding[22]);
+				calibInit(&uiRegHolding[5], &uiRegHolding[12]);
 			}
 
 			//  ,   
@@ -585,11 +649,13 @@ int main()
 			if(0x0080 & uiRegHolding[14]) {
 				uiRegHolding[14] &= ~0x0080;
 				eeprom_update_block((void*)&uiRegHolding[5], (void*)&arrADCConstEEPROM, sizeof(arrADCConstEEPROM));
+				eeprom_update_block((void*)&uiRegHolding[22], (void*)&arrADCFilterEEPROM, sizeof(arrADCFilterEEPROM));
 			}
 			///////////////////////////////////////////////////////////////////////////////////////////////////////////
 			if(0x2000 & uiRegHolding[14]) {
 				uiRegHolding[14] &= ~0x2000;
 				dacLoadDefConst(&uiRegHolding[12]);
+				calibInit(&uiRegHolding[5], &uiRegHolding[12]);
 			}
 
 			//  ,   
@@ -597,6 +663,7 @@ int main()
 			if(0x4000 & uiRegHolding[14]) {
 				uiRegHolding[14] &= ~0x4000;
 				eeprom_read_block((void*)&uiRegHolding[12], (void*)&arrDACConstEEPROM, sizeof(arrDACConstEEPROM));
+				calibInit(&uiRegHolding[5], &uiRegHolding[12]);
 			}
 
 			//  ,   
@@ -606,23 +673,34 @@ int main()
 				eeprom_update_block((void*)&uiRegHolding[12], (void*)&arrDACConstEEPROM, sizeof(arrDACConstEEPROM));
 			}
 		}
-
+		profMark( PROF_STAGE_CONFIG );
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		readADC();
+		{
+			ADC_FRAME frame;
+
+			if( adcGetFrame( &frame ) ) {
+				for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+					arrADC[i] = adcFilterToCounts( frame.filtered[i] );
+					uiRegInputBuf[19 + i] = frame.timestamp[i];
+					uiRegInputBuf[26 + i] = frame.filtered[i];
+				}
+			}
+		}
 
 		memcpy( uiRegInputBuf, (void*)&arrADC, sizeof( arrADC ) );
 
-		for( i = 0; i < 7; i++ ) {
-		//	uiRegInputBuf[7 + i] = ( 10000 * (uint32_t)arrADC[i]) / (uiRegHolding[5 + i] );
+		for( i = 0; i < NUMBER_OF_ADC_CHANNEL; i++ ) {
+			uiRegInputBuf[7 + i] = calibAdcToCentiVolt( i, arrADC[i] );
 		}
 
-		n = 0;
+		n = 7;
 		for(i = 14; i < 18; i++) {
-			uiRegInputBuf[i] = 0x00ff & (uiRegInputBuf[++n] / 10);
-			if( ++n < 14 ) {
-				uiRegInputBuf[i] |= ( 0xff00 & ((uiRegInputBuf[n] / 10)<<8) );
+			uiRegInputBuf[i] = 0x00ff & (uiRegInputBuf[n++] / 10);
+			if( n < 14 ) {
+				uiRegInputBuf[i] |= ( 0xff00 & ((uiRegInputBuf[n++] / 10)<<8) );
 			}
 		}
+		profMark( PROF_STAGE_ADC );
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 		readDigitalInput( (uint8_t*)inPort );
 
@@ -639,143 +717,59 @@ int main()
 				ucRegDiscBuf[n] &= ~(1<<(i - 8 * n));
 			}
 		}
+		profMark( PROF_STAGE_DIGITAL_IO );
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// Handle sd card plugging:
-		if( !sd_raw_available() && sd_get_root_dir() ) {
-			fat16_close_dir(dir);
-			sd_close();
-			dir = 0;
-			printf_P(PSTR("[sd] card unplugged\n"));
-		} else {
-			if( !sd_get_root_dir() && sd_raw_available() ) {
-				//spi_init();
-				sd_raw_init();
-
-				switch(sd_open()) {
-				case SD_ERROR_NONE:
-					dir = sd_get_root_dir();
-					printf_P(PSTR("[sd] card initialized\n"));
-				 break;
-
-				case SD_ERROR_FS: printf_P(PSTR("[sd] opening filesystem failed\n")); break;
-				case SD_ERROR_INIT: printf_P(PSTR("[sd] MMC/SD initialization failed\n")); break;
-				case SD_ERROR_PARTITION: printf_P(PSTR("[sd] opening partition failed\n")); break;
-				case SD_ERROR_ROOTDIR: printf_P(PSTR("[sd] opening root directory failed\n")); break;
-
-				default: printf_P(PSTR("[sd] unknown error\n")); break;
-				}
-			}
-		}
+		// Background services, see initTasks():
+		sched_run();
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		if( rs485_address_switch_old != uiRegInputBuf[18] ) {
-			eMBDisable();
+		// The position loop runs in servoTick(), here only the diagnostics:
+		if( bDoPID ) {
+			uint32_t nTick;
+			///////////////////////////////////////////////////////////////////////////////////////////////////////////
+			cli();
+			bDoPID = 0;
+			nTick = nServoTicks;
+			sei();
 
-			if( 64 & uiRegInputBuf[18] ) {
-				eStatus = eMBTCPInit( 502 );
-			} else {
-				eStatus = eMBInit( MB_RTU, 10, 0, 115200, MB_PAR_EVEN );
-			}
+			if( nTick - nSpiLoadTick >= 1000 ) {
+				nSpiLoadTick = nTick;
+				spiLoadUpdate();
+				dacGetLatency( &uiRegInputBuf[45], &uiRegInputBuf[46] );
+				refreshDigitalOutput();
 
-			if( MB_ENOERR == eStatus ) {
-				eMBEnable();
-			} else {
-				asm("nop\n");
-			}
-		}
+				cli();
+				uiRegInputBuf[47] = nServoOverruns;
+				uiRegInputBuf[48] = nServoTimeMax;
+				uiRegInputBuf[49] = nServoTimeWorst;
+				nServoTimeMax = nServoTime;
+				sei();
 
-		/* handle network link changes */
-		if( //( rs485_address_switch_old != uiRegInputBuf[18] ) ||
-			( !net_link_up && hal_link_up() )
-		) {
-			if( 0x0080 & uiRegInputBuf[18] ) {
-				dhcp_client_start(dhcp_client_event_callback);
-			} else {
-				uint8_t ip_addr[4] = { 10, 0, 2, 76 };
-				uint8_t netmask[4] = { 255, 255, 255, 0 };
-				uint8_t gateway[4] = { 10, 0, 2, 1 };
-
-				ip_init(
-					(unsigned char*)ip_addr,
-					(unsigned char*)netmask,
-					(unsigned char*)gateway
-				);
-			}
+				profUpdate();
+				uiRegInputBuf[50] = profGetLoopRate();
+				for( i = 0; i < NUMBER_OF_PROF_STAGE; i++ ) {
+					PROF_STAGE stage;
 
-			net_link_up = 1;
-		} else {
-			if( ( net_link_up && !hal_link_up() )
-			) {
-				if( 0x0080 & uiRegInputBuf[18] ) {
-					dhcp_client_abort();
+					profGetStage( i, &stage );
+					uiRegInputBuf[51 + 3 * i] = stage.min;
+					uiRegInputBuf[52 + 3 * i] = stage.avg;
+					uiRegInputBuf[53 + 3 * i] = stage.max;
 				}
 
-				ip_init(0, 0, 0);
-
-				net_link_up = 0;
-			}
-		}
-
-		rs485_address_switch_old = uiRegInputBuf[18];
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// Receive packets:
-		while( ethernet_handle_packet() && !bDoPID );
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		// Handle timeouts:
-		cli();
-		uint8_t timer_ticks = 20; // timer_events;
-		timer_events = 0;
-		sei();
-
-		while( timer_ticks-- ) {
-			timer_interval();
-		}
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		uiRegInputBuf[39] = nEncoderPositionOld ;
-		uiRegInputBuf[40] = nEncoderPositionOld>>16;
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		eMBPoll();
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		fb = 0;
-		if( outPort[0] ) {
-			if( bDoPID ) {
-				int16_t dac, SpeedLimit;
-				motion_t nNewPosition;
-				///////////////////////////////////////////////////////////////////////////////////////////////////////
-				cli();
-				bDoPID = 0;
-				nEncoderPositionOld = nEncoderPosition;
-				sei();
-				///////////////////////////////////////////////////////////////////////////////////////////////////////
-				//nNewPosition = ((int32_t)(uiRegHolding[56])<<16 | uiRegHolding[55]);
-				nNewPosition = motionGetCurrentPosition() / NUMBER_SCALE;
-				SpeedLimit = uiRegHolding[66];
-				////////////////////////////////////////////////////////////////////////////////
-				dac = pid_Controller( nNewPosition, nEncoderPositionOld, (pidData_t*)&pidPosData );
-				if( dac < 0 ) {
-					dac = -dac;
-					fb = 1;
+				const uint16_t* netStats = net_stats_get();
+				for( i = 0; i < NET_STAT_COUNT; i++ ) {
+					uiRegInputBuf[78 + i] = netStats[i];
 				}
-				if( dac > SpeedLimit ) {
-					dac = SpeedLimit;
-				}
-				arrDAC[0] = dac * 510;
-				///////////////////////////////////////////////////////////////////////////////////////////////////////
-				MotionUpdate();
-			}
-		} else {
-			pid_Reset_Integrator( (pidData_t*)&pidPosData );
-			uiRegHolding[56] = uiRegHolding[55] = 0;
-			arrDAC[0] = 0;
-
-			motionSetCurrentPosition( 0 );
-			motionSetTargetPosition( 0 );
-			motionSetCurrentVelocity( 0 );
-			motionSetRunState( eStopped );
 
-			cli();
-			nEncoderPosition = 0;
-			sei();
+				const struct tcp_rx_stats* rxStats = tcp_get_rx_stats();
+				uiRegInputBuf[110] = (uint16_t)rxStats->bytes_received;
+				uiRegInputBuf[111] = (uint16_t)(rxStats->bytes_received >> 16);
+				uiRegInputBuf[112] = (uint16_t)rxStats->bytes_queued;
+				uiRegInputBuf[113] = (uint16_t)(rxStats->bytes_queued >> 16);
+				uiRegInputBuf[114] = (uint16_t)rxStats->bytes_direct;
+				uiRegInputBuf[115] = (uint16_t)(rxStats->bytes_direct >> 16);
+			}
 		}
+		profMark( PROF_STAGE_PID );
 
 		if( 1 ) { //!((64 | 32) & isRun) && (1 & isRun) ) {
 			for(i = 0; i < 12; i++) {
@@ -790,13 +784,21 @@ int main()
 				}
 			}
 
+			// arrDAC[1] is read by servoTick():
 			switch(0x03 & (uiRegHolding[14]>>10)) {
 			case 1:
+				cli();
 				arrDAC[1] = uiRegHolding[1];
+				sei();
 			 break;
 
-			case 2:
-				arrDAC[1] = ((float)uiRegHolding[13]/1000.0) * (float)uiRegHolding[3];
+			case 2: {
+				uint16_t dac = calibCentiVoltToDac( 1, uiRegHolding[3] );
+
+				cli();
+				arrDAC[1] = dac;
+				sei();
+			}
 			 break;
 			}
 
@@ -806,7 +808,7 @@ int main()
 			 break;
 
 			case 2:
-				//arrDAC[0] = ((float)uiRegHolding[12]/1000.0) * (float)uiRegHolding[2];
+				//arrDAC[0] = calibCentiVoltToDac( 0, uiRegHolding[2] );
 			 break;
 			}
 		} else {
@@ -817,6 +819,7 @@ int main()
 			memset( &ucRegCoilsBuf, 0, sizeof(ucRegCoilsBuf) );
 		}
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		fb = bServoReverse;
 		outPort[3] = fb;
 		if( !fb ) {
 			ucRegCoilsBuf[0] &= ~8;
@@ -824,8 +827,7 @@ int main()
 			ucRegCoilsBuf[0] |=  8;
 		}
 		writeDigitalOutput( (uint8_t*)outPort );
-		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-		writeDac( arrDAC[0], arrDAC[1] );
+		profMark( PROF_STAGE_DAC );
 		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	}
 	
@@ -837,12 +839,308 @@ ISR( TIMER2_COMP_vect )
 {
 	volatile static uint8_t n = 0;
 
-	if( 2 == ++n ) {
+	// One timer tick per TIMER_MS_PER_TICK milliseconds, missed ticks are caught up by the main loop:
+	if( TIMER_MS_PER_TICK == ++n ) {
 		++timer_events;
 		n = 0;
 	}
 
+	++nServoTicks;
 	bDoPID = 1;
+
+	dacTick();
+	adcSequencerTick();
+
+	// The servo tick runs with interrupts enabled, so the encoder and SPI
+	// interrupts are served meanwhile. A tick arriving before the previous
+	// one has finished is skipped:
+	if( bServoBusy ) {
+		++nServoOverruns;
+		return;
+	}
+	bServoBusy = 1;
+
+	sei();
+	servoTick( nServoTicks );
+	cli();
+
+	bServoBusy = 0;
+}
+
+/*
+	Encoder snapshot -> motion profile -> PID -> DAC, once per servo tick
+	from TIMER2_COMP_vect. The main loop must not touch the PID or motion
+	state without servoLock().
+*/
+static void servoTick(uint32_t nTick)
+{
+	uint16_t nStart = timebase_now(), nTime;
+	int32_t nPosition, nCommand = 0;
+
+	cli();
+	nPosition = nEncoderPosition;
+	sei();
+
+	nEncoderPositionOld = nPosition;
+	encoderPublishSnapshot( nPosition, nTick );
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	if( outPort[0] ) {
+		int16_t dac, SpeedLimit;
+		motion_t nNewPosition;
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		//nNewPosition = ((int32_t)(uiRegHolding[56])<<16 | uiRegHolding[55]);
+		nNewPosition = motionGetCurrentPosition() / NUMBER_SCALE;
+		nCommand = nNewPosition;
+		SpeedLimit = uiRegHolding[66];
+		////////////////////////////////////////////////////////////////////////////////
+		dac = pid_Controller( nNewPosition, nPosition, (pidData_t*)&pidPosData );
+		bServoReverse = 0;
+		if( dac < 0 ) {
+			dac = -dac;
+			bServoReverse = 1;
+		}
+		if( dac > SpeedLimit ) {
+			dac = SpeedLimit;
+		}
+		arrDAC[0] = dac * 510;
+		///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+		MotionUpdate();
+	} else {
+		pid_Reset_Integrator( (pidData_t*)&pidPosData );
+		uiRegHolding[56] = uiRegHolding[55] = 0;
+		arrDAC[0] = 0;
+		bServoReverse = 0;
+
+		motionSetCurrentPosition( 0 );
+		motionSetTargetPosition( 0 );
+		motionSetCurrentVelocity( 0 );
+		motionSetRunState( eStopped );
+
+		cli();
+		nEncoderPosition = 0;
+		sei();
+	}
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Latched by dacTick() on the next servo tick:
+	writeDac( arrDAC[0], arrDAC[1], nTick );
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Every telemetry divider ticks, sent by taskTelemetry():
+	if( telemetryDue( ) ) {
+		TELEMETRY_SAMPLE sample;
+		uint8_t i;
+
+		sample.tick = nTick;
+		sample.position = nPosition;
+		sample.command = nCommand;
+		sample.error = nCommand - nPosition;
+		if( outPort[0] ) {
+			sample.pTerm = pidPosData.lastPTerm;
+			sample.iTerm = pidPosData.lastITerm;
+			sample.dTerm = pidPosData.lastDTerm;
+		} else {
+			sample.pTerm = sample.iTerm = sample.dTerm = 0;
+		}
+		sample.dac = arrDAC[0];
+		for( i = 0; i < NUMBER_OF_TELEMETRY_ADC; i++ ) {
+			sample.adc[i] = arrADC[i];
+		}
+		telemetrySample( &sample );
+	}
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	nTime = (uint16_t)(timebase_now() - nStart) / TIMEBASE_TICKS_PER_US;
+
+	cli();
+	nServoTime = nTime;
+	if( nTime > nServoTimeMax ) {
+		nServoTimeMax = nTime;
+	}
+	if( nTime > nServoTimeWorst ) {
+		nServoTimeWorst = nTime;
+	}
+	sei();
+}
+
+/*
+	Keeps servoTick() from running while the main loop changes the PID or
+	motion state. A tick arriving meanwhile is delayed, not lost.
+*/
+static void servoLock(void)
+{
+	cli();
+	TIMSK &= ~(1<<OCIE2);
+	sei();
+}
+
+static void servoUnlock(void)
+{
+	cli();
+	TIMSK |= (1<<OCIE2);
+	sei();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Background services, run by sched_run() from the main loop. Every call does one step and
+// returns whether there is more work. Modbus has the highest priority, so it is polled
+// again between two packets of e.g. a long HTTP transfer.
+#define TASK_PRIORITY_MODBUS					0
+#define TASK_PRIORITY_TIMER						1
+#define TASK_PRIORITY_ETHERNET					2
+#define TASK_PRIORITY_TELEMETRY					3
+#define TASK_PRIORITY_HOTPLUG					4
+
+static bool taskModbus(void)
+{
+	ENCODER_SNAPSHOT snapshot;
+
+	encoderGetSnapshot( &snapshot );
+
+	uiRegInputBuf[39] = snapshot.position;
+	uiRegInputBuf[40] = snapshot.position>>16;
+	uiRegInputBuf[41] = snapshot.velocity;
+	uiRegInputBuf[42] = snapshot.velocity>>16;
+	uiRegInputBuf[43] = snapshot.timestamp;
+	uiRegInputBuf[44] = snapshot.timestamp>>16;
+
+	eMBPoll();
+
+	profMark( PROF_STAGE_MODBUS );
+	return false;
+}
+
+// One timer tick per step:
+static bool taskTimer(void)
+{
+	bool bMore;
+
+	cli();
+	if( !timer_events ) {
+		sei();
+		return false;
+	}
+	bMore = 0 != --timer_events;
+	sei();
+
+	timer_interval();
+
+	profMark( PROF_STAGE_TIMER );
+	return bMore;
+}
+
+// One received packet per step:
+static bool taskEthernet(void)
+{
+	uint8_t n;
+
+	n = ethernet_handle_packet();
+
+	profMark( PROF_STAGE_ETHERNET );
+	return n;
+}
+
+// One telemetry datagram per step:
+static bool taskTelemetry(void)
+{
+	bool bMore;
+
+	bMore = telemetryTask();
+
+	profMark( PROF_STAGE_ETHERNET );
+	return bMore;
+}
+
+// SD card plugging, network link and Modbus mode changes:
+static bool taskHotplug(void)
+{
+	eMBErrorCode eStatus;
+
+	// Handle sd card plugging:
+	if( !sd_raw_available() && sd_get_root_dir() ) {
+		fat16_close_dir(sd_root_dir);
+		sd_close();
+		sd_root_dir = 0;
+		printf_P(PSTR("[sd] card unplugged\n"));
+	} else {
+		if( !sd_get_root_dir() && sd_raw_available() ) {
+			//spi_init();
+			sd_raw_init();
+
+			switch(sd_open()) {
+			case SD_ERROR_NONE:
+				sd_root_dir = sd_get_root_dir();
+				printf_P(PSTR("[sd] card initialized\n"));
+			 break;
+
+			case SD_ERROR_FS: printf_P(PSTR("[sd] opening filesystem failed\n")); break;
+			case SD_ERROR_INIT: printf_P(PSTR("[sd] MMC/SD initialization failed\n")); break;
+			case SD_ERROR_PARTITION: printf_P(PSTR("[sd] opening partition failed\n")); break;
+			case SD_ERROR_ROOTDIR: printf_P(PSTR("[sd] opening root directory failed\n")); break;
+
+			default: printf_P(PSTR("[sd] unknown error\n")); break;
+			}
+		}
+	}
+	///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	if( rs485_address_switch_old != uiRegInputBuf[18] ) {
+		eMBDisable();
+
+		if( 64 & uiRegInputBuf[18] ) {
+			eStatus = eMBTCPInit( 502 );
+		} else {
+			eStatus = eMBInit( MB_RTU, 10, 0, 115200, MB_PAR_EVEN );
+		}
+
+		if( MB_ENOERR == eStatus ) {
+			eMBEnable();
+		} else {
+			asm("nop\n");
+		}
+	}
+
+	/* handle network link changes */
+	if( //( rs485_address_switch_old != uiRegInputBuf[18] ) ||
+		( !net_link_up && hal_link_up() )
+	) {
+		if( 0x0080 & uiRegInputBuf[18] ) {
+			dhcp_client_start(dhcp_client_event_callback);
+		} else {
+			uint8_t ip_addr[4] = { 10, 0, 2, 76 };
+			uint8_t netmask[4] = { 255, 255, 255, 0 };
+			uint8_t gateway[4] = { 10, 0, 2, 1 };
+
+			ip_init(
+				(unsigned char*)ip_addr,
+				(unsigned char*)netmask,
+				(unsigned char*)gateway
+			);
+		}
+
+		net_link_up = 1;
+	} else {
+		if( ( net_link_up && !hal_link_up() )
+		) {
+			if( 0x0080 & uiRegInputBuf[18] ) {
+				dhcp_client_abort();
+			}
+
+			ip_init(0, 0, 0);
+
+			net_link_up = 0;
+		}
+	}
+
+	rs485_address_switch_old = uiRegInputBuf[18];
+
+	profMark( PROF_STAGE_SD );
+	return false;
+}
+
+void initTasks(void)
+{
+	sched_task_add( taskModbus, TASK_PRIORITY_MODBUS, 2000 );
+	sched_task_add( taskTimer, TASK_PRIORITY_TIMER, 2000 );
+	sched_task_add( taskEthernet, TASK_PRIORITY_ETHERNET, 5000 );
+	sched_task_add( taskTelemetry, TASK_PRIORITY_TELEMETRY, 2000 );
+	sched_task_add( taskHotplug, TASK_PRIORITY_HOTPLUG, 0 );
 }
 
 void dhcp_client_event_callback(enum dhcp_client_event event)
@@ -869,10 +1167,33 @@ void dhcp_client_event_callback(enum dhcp_client_event event)
 	}
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+static MCP23SXX mcpDigitalIn, mcpDigitalOut, mcpAddressSwitch;
+
+static void selectDigitalIn(uint8_t select)
+{
+	if( select ) select_digital_in();
+	else unselect_digital_in();
+}
+
+static void selectDigitalOut(uint8_t select)
+{
+	if( select ) select_digital_out();
+	else unselect_digital_out();
+}
+
+static void selectAddressSwitch(uint8_t select)
+{
+	if( select ) select_address_switch();
+	else unselect_address_switch();
+}
+
 void initDigitalInput(uint8_t in[16])
 {
 	memset(in, 0, sizeof(in));
 
+	spi_device_init(SPI_DEVICE_DIGITAL_IN, selectDigitalIn, 0, (1<<SPI2X));
+	mcp23sxx_init(&mcpDigitalIn, SPI_DEVICE_DIGITAL_IN);
+
 	select_digital_in();
 	mcp23s08_ddr_init(0x00);
 	unselect_digital_in();
@@ -880,23 +1201,35 @@ void initDigitalInput(uint8_t in[16])
 	select_digital_in();
 	mcp23s08_input_polarity(0x3F);
 	unselect_digital_in();	
+
+	select_digital_in();
+	mcp23s08_interrupt_on_change(0xff);
+	unselect_digital_in();
 }
 
 void readDigitalInput(uint8_t in[16])
 {
 	uint8_t i, temp, outa, outb;
+#ifdef digital_in_changed
+	static uint8_t first = 1;
 
-	select_digital_in();
-	temp = mcp23sxx_spi_read(MCP23S08_GPIO);
-	unselect_digital_in();
+	// Reading GPIO clears the INT output:
+	if(first || digital_in_changed()) {
+		first = 0;
+		mcp23sxx_read_gpio(&mcpDigitalIn, MCP23S08_GPIO, 1);
+	}
+#else
+	mcp23sxx_read_gpio(&mcpDigitalIn, MCP23S08_GPIO, 1);
+#endif
+	// GPIOA and GPIOB in one transaction:
+	mcp23sxx_read_gpio(&mcpDigitalOut, MCP23S17_GPIOA, 2);
 
-	select_digital_out();
-	outa = mcp23sxx_spi_read(MCP23S17_GPIOA);
-	unselect_digital_out();
+	mcp23sxx_wait(&mcpDigitalIn);
+	mcp23sxx_wait(&mcpDigitalOut);
 
-	select_digital_out();
-	outb = mcp23sxx_spi_read(MCP23S17_GPIOB);
-	unselect_digital_out();
+	temp = mcpDigitalIn.gpio[0];
+	outa = mcpDigitalOut.gpio[0];
+	outb = mcpDigitalOut.gpio[1];
 	
 	// ID[0..5]
 	for(i = 0; i < 6; i++) {
@@ -921,6 +1254,9 @@ void initDigitalOutput(uint8_t out[12])
 {
 	memset(out, 0, sizeof(out));
 
+	spi_device_init(SPI_DEVICE_DIGITAL_OUT, selectDigitalOut, 0, (1<<SPI2X));
+	mcp23sxx_init(&mcpDigitalOut, SPI_DEVICE_DIGITAL_OUT);
+
 	select_digital_out();
 	mcp23sxx_spi_write(MCP23S17_IODIRA, (unsigned char)~0xef);
 	unselect_digital_out();
@@ -934,6 +1270,7 @@ void writeDigitalOutput(uint8_t out[12])
 {
 	int i;
 	unsigned int gpio = 0;
+	uint8_t port[2];
 	static unsigned int digitalOutMap[] = {
 		0x0400,	// DO0	<> GPB2
 		0x0800,	// DO1	<> GPB3
@@ -955,17 +1292,24 @@ void writeDigitalOutput(uint8_t out[12])
 		}
 	}
 
-	select_digital_out();
-	mcp23s17_write_outa((char)gpio);
-	unselect_digital_out();
+	// Only the ports which changed are written:
+	port[0] = gpio;
+	port[1] = gpio>>8;
+	mcp23sxx_write_gpio(&mcpDigitalOut, MCP23S17_GPIOA, port, 2);
+}
 
-	select_digital_out();
-	mcp23s17_write_outb((char)(gpio>>8));
-	unselect_digital_out();
+// The next writeDigitalOutput() writes both ports again, restores latches
+// the expander lost (glitch on its supply or reset line):
+void refreshDigitalOutput(void)
+{
+	mcp23sxx_invalidate(&mcpDigitalOut);
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void initAddressSwitch(void)
 {
+	spi_device_init(SPI_DEVICE_ADDRESS_SWITCH, selectAddressSwitch, 0, (1<<SPI2X));
+	mcp23sxx_init(&mcpAddressSwitch, SPI_DEVICE_ADDRESS_SWITCH);
+
 	select_address_switch();
 	mcp23s08_ddr_init(0x00);
 	unselect_address_switch();
@@ -977,13 +1321,28 @@ void initAddressSwitch(void)
 
 char readAddressSwitch(void)
 {
-	char temp;
+	mcp23sxx_read_gpio(&mcpAddressSwitch, MCP23S08_GPIO, 1);
+	mcp23sxx_wait(&mcpAddressSwitch);
 
-	select_address_switch();
-	temp = mcp23sxx_spi_read(MCP23S08_GPIO);
-	unselect_address_switch();
+	return mcpAddressSwitch.gpio[0];
+}
 
-	return temp;
+// SPI bus load of the scheduler devices and the blocking drivers, 0.1% units:
+void spiLoadUpdate(void)
+{
+	static uint32_t busTimeOld[SPI_MAX_DEVICES + 1];
+	struct spi_stats stats;
+	uint8_t i;
+
+	for(i = 0; i <= SPI_STATS_BLOCKING; i++) {
+		spi_get_stats(i, &stats);
+		uiRegInputBuf[33 + i] = (stats.bus_time - busTimeOld[i]) / (1000 * TIMEBASE_TICKS_PER_US);
+		busTimeOld[i] = stats.bus_time;
+	}
+
+	// Longest blocking transaction, stats holds SPI_STATS_BLOCKING here:
+	uiRegInputBuf[116] = stats.max_time / TIMEBASE_TICKS_PER_US;
+	spi_reset_max_time(SPI_STATS_BLOCKING);
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 eMBErrorCode eMBRegDiscreteCB(UCHAR * pucRegBuffer, USHORT usAddress, USHORT usNDiscrete)
@@ -1124,6 +1483,16 @@ eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
 				--usNRegs;
 			}
 			///////////////////////////////////////////////////////////////////////////////////////////////////////////
+			if( usAddress - 1 < 29 && iRegIndex > 22 ) {
+				adcFilterSetupAll( &uiRegHolding[22] );
+			}
+
+			if( usAddress - 1 < 14 && iRegIndex > 5 ) {
+				calibInit( &uiRegHolding[5], &uiRegHolding[12] );
+			}
+			///////////////////////////////////////////////////////////////////////////////////////////////////////////
+			servoLock();
+
 			if( 50 == iRegIndex ) {
 				p_factor = uiRegHolding[49];
 				pid_Init( p_factor, i_factor, d_factor, (pidData_t*)&pidPosData );
@@ -1177,6 +1546,8 @@ eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
 				SetMaxSpeed( (int32_t)(uiRegHolding[64])<<16 | uiRegHolding[63] );
 				MoveTo( ((int32_t)(uiRegHolding[56])<<16 | uiRegHolding[55]) );
 			}
+
+			servoUnlock();
 			///////////////////////////////////////////////////////////////////////////////////////////////////////////
 			if(0x0080 & uiRegHolding[4]) {
 				uiRegHolding[4] = (0x007f & dac) | (0xff00 & uiRegHolding[4]);
@@ -1205,33 +1576,3 @@ eMBErrorCode eMBRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
 	return MB_ENOREG;
 }
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void ftoa(float f, char *buffer)
-{
-	int d;
-	unsigned char i, str[11];
-
-	if( f < 0 ) {
-		f = -f;
-		*buffer++ = '-';
-	}
-
-	d = f;
-	itoa(d, (char*)str, 10);
-
-	i = 0;
-	while(str[i]) *buffer++ = str[i++];
-
-	*buffer++ = '.';
-
-	if((int)(((f - d) + 0.001) * 100) < 10) {
-		*buffer++ = '0';
-	}
-
-	itoa((int)(((f - d) + 0.001) * 100), (char*)str, 10);
-
-	i = 0;
-	while(str[i]) *buffer++ = str[i++];
-
-	*buffer = 0;
-}
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
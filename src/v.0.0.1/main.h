@@ -16,22 +16,28 @@
 #include "app/dhcp_client.h"
 #include "app/httpd.h"
 #include "arch/spi.h"
+#include "arch/timebase.h"
 #include "arch/uart.h"
 #include "net/arp.h"
 #include "net/ethernet.h"
 #include "net/hal.h"
 #include "net/icmp.h"
 #include "net/ip.h"
+#include "net/net_stats.h"
 #include "net/tcp.h"
 #include "net/udp.h"
 #include "sd/fat16.h"
 #include "sd/sd.h"
 #include "sd/sd_raw.h"
 #include "sys/clock.h"
+#include "sys/sched.h"
 #include "sys/timer.h"
 
 #include "adc/adc.h"
 #include "dac/dac.h"
+#include "calib/calib.h"
+#include "prof/prof.h"
+#include "telemetry/telemetry.h"
 
 #include "mcp23sxx/mcp23sxx.h"
 #include "mcp23sxx/mcp23s08.h"
@@ -111,6 +117,17 @@
 #define select_address_switch()			(PORTD &= ~CPU_CS_RS485_ADDRESS_bm)
 #define unselect_address_switch()		(PORTD |= CPU_CS_RS485_ADDRESS_bm)
 
+// INT output of the digital input expander, interrupt-on-change. Not routed
+// to the CPU on this board, define it to read the inputs only after a change:
+//#define digital_in_changed()			(!(PING & DI_INT_bm))
+
+// Devices of the SPI job scheduler, see arch/spi.h:
+#define SPI_DEVICE_ANALOG_IN			0
+#define SPI_DEVICE_ANALOG_OUT			1
+#define SPI_DEVICE_DIGITAL_IN			2
+#define SPI_DEVICE_DIGITAL_OUT			3
+#define SPI_DEVICE_ADDRESS_SWITCH		4
+
 /////////////////////////////////////////////////////
 void initAddressSwitch(void);
 char readAddressSwitch(void);
@@ -120,8 +137,9 @@ void readDigitalInput(uint8_t in[16]);
 /////////////////////////////////////////////////////
 void initDigitalOutput(uint8_t out[12]);
 void writeDigitalOutput(uint8_t out[12]);
+void refreshDigitalOutput(void);
+/////////////////////////////////////////////////////
+void spiLoadUpdate(void);
 /////////////////////////////////////////////////////
-
-void ftoa(float f, char *buffer);
 
 #endif
@@ -18,3 +18,12 @@ void mcp23s08_input_polarity(char ipol)
 {
 	mcp23sxx_spi_write(MCP23S08_IPOL, ipol);
 }
+
+/*
+	If Bit 1 - INT output goes active when the pin changes (INTCON reset
+	value: compare against the previous value), cleared by reading GPIO
+*/
+void mcp23s08_interrupt_on_change(char mask)
+{
+	mcp23sxx_spi_write(MCP23S08_GPINTE, mask);
+}
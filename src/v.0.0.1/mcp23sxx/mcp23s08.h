@@ -15,5 +15,6 @@
 
 void mcp23s08_ddr_init(char ddr);
 void mcp23s08_input_polarity(char ipol);
+void mcp23s08_interrupt_on_change(char mask);
 
 #endif
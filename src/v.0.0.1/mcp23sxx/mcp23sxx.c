@@ -1,4 +1,5 @@
 #include <avr/io.h>
+#include <string.h>
 #include "mcp23sxx.h"
 
 char mcp23sxx_spi_read(char address)
@@ -26,3 +27,88 @@ void mcp23sxx_spi_write(char address, char data)
 	SPDR = data;
 	while(!(SPSR & (1<<SPIF)));
 }
+
+///////////////////////////////////////////////////////////
+// Runs in the SPI interrupt:
+static void mcp23sxx_job_done(struct spi_job *job)
+{
+	LP_MCP23SXX lpMcp = (LP_MCP23SXX)job;
+
+	if(lpMcp->reading) {
+		memcpy(lpMcp->gpio, &lpMcp->data[2], job->length - 2);
+	}
+}
+
+void mcp23sxx_init(LP_MCP23SXX lpMcp, uint8_t device)
+{
+	memset(lpMcp, 0, sizeof(*lpMcp));
+
+	lpMcp->job.data = lpMcp->data;
+	lpMcp->job.device = device;
+	lpMcp->job.done = mcp23sxx_job_done;
+}
+
+/*
+	Forget the shadow registers, e.g. after the expander has been reset.
+*/
+void mcp23sxx_invalidate(LP_MCP23SXX lpMcp)
+{
+	lpMcp->olatValid = 0;
+}
+
+/*
+	Queue a sequential read of 'count' registers starting at 'address'.
+	The values are in lpMcp->gpio[] after mcp23sxx_wait().
+*/
+uint8_t mcp23sxx_read_gpio(LP_MCP23SXX lpMcp, char address, uint8_t count)
+{
+	mcp23sxx_wait(lpMcp);
+
+	lpMcp->data[0] = 0x41;
+	lpMcp->data[1] = address;
+	memset(&lpMcp->data[2], 0, count);
+	lpMcp->job.length = 2 + count;
+	lpMcp->reading = 1;
+
+	return spi_job_submit(&lpMcp->job);
+}
+
+/*
+	Write 'count' registers starting at 'address', skipping the leading
+	and trailing ones which already hold the value. Returns 0 if nothing
+	had to be written.
+*/
+uint8_t mcp23sxx_write_gpio(LP_MCP23SXX lpMcp, char address, const uint8_t *value, uint8_t count)
+{
+	uint8_t first = 0, last = count;
+
+	if(lpMcp->olatValid) {
+		while(first < last && value[first] == lpMcp->olat[first]) {
+			++first;
+		}
+		if(first == last) {
+			return 0;
+		}
+		while(value[last - 1] == lpMcp->olat[last - 1]) {
+			--last;
+		}
+	}
+
+	mcp23sxx_wait(lpMcp);
+
+	lpMcp->data[0] = 0x40;
+	lpMcp->data[1] = address + first;
+	memcpy(&lpMcp->data[2], &value[first], last - first);
+	lpMcp->job.length = 2 + last - first;
+	lpMcp->reading = 0;
+
+	memcpy(lpMcp->olat, value, count);
+	lpMcp->olatValid = 1;
+
+	return spi_job_submit(&lpMcp->job);
+}
+
+void mcp23sxx_wait(LP_MCP23SXX lpMcp)
+{
+	spi_job_wait(&lpMcp->job);
+}
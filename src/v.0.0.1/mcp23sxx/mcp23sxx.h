@@ -1,9 +1,36 @@
 #ifndef __MCP23SXX_H__
 #define __MCP23SXX_H__
 
+#include <stdint.h>
+#include "../arch/spi.h"
+
 #define mcp23sxx_spi_set()		spi_high_frequency()
 
+// Ports of the largest expander, MCP23S17 GPIOA and GPIOB:
+#define MCP23SXX_PORTS			2
+
+/*
+	Shadow registers of one expander, accessed through the SPI job
+	scheduler. Register accesses use the sequential mode (IOCON.SEQOP = 0,
+	the reset default), so both ports of a MCP23S17 (IOCON.BANK = 0) are
+	read or written in one transaction.
+*/
+typedef struct {
+	struct spi_job job;							// must be first
+	uint8_t data[2 + MCP23SXX_PORTS];			// opcode, address, registers
+	uint8_t reading;
+	uint8_t gpio[MCP23SXX_PORTS];				// port values of the last read
+	uint8_t olat[MCP23SXX_PORTS];				// port values of the last write
+	uint8_t olatValid;							// 0 - write all ports next time
+} MCP23SXX, *LP_MCP23SXX;
+
 char mcp23sxx_spi_read(char address);
 void mcp23sxx_spi_write(char address, char data);
 
+void mcp23sxx_init(LP_MCP23SXX lpMcp, uint8_t device);
+void mcp23sxx_invalidate(LP_MCP23SXX lpMcp);
+uint8_t mcp23sxx_read_gpio(LP_MCP23SXX lpMcp, char address, uint8_t count);
+uint8_t mcp23sxx_write_gpio(LP_MCP23SXX lpMcp, char address, const uint8_t *value, uint8_t count);
+void mcp23sxx_wait(LP_MCP23SXX lpMcp);
+
 #endif
@@ -16,6 +16,7 @@
 #include "ethernet.h"
 #include "ip.h"
 #include "net.h"
+#include "net_stats.h"
 
 /**
  * \addtogroup net
@@ -68,12 +69,29 @@ struct arp_entry
     uint8_t ip[4];
 };
 
+struct arp_pending
+{
+    uint8_t timeout;
+    uint8_t ip[4];
+    uint16_t type;
+    uint16_t data_len;
+    uint8_t data[ARP_PENDING_SIZE];
+};
+
+#if ARP_TABLE_SIZE & (ARP_TABLE_SIZE - 1)
+#error ARP_TABLE_SIZE must be a power of two
+#endif
+
 static void arp_interval(int timer);
 static bool arp_generate_reply(const struct arp_header* packet);
 static bool arp_generate_request(const uint8_t* ip);
 static void arp_insert(const uint8_t* mac, const uint8_t* ip);
+static struct arp_entry* arp_find(const uint8_t* ip);
+static uint8_t arp_hash(const uint8_t* ip);
+static void arp_send_pending(const uint8_t* mac, const uint8_t* ip);
 
 static struct arp_entry arp_table[ARP_TABLE_SIZE];
+static struct arp_pending arp_pending[ARP_PENDING_COUNT];
 
 /**
  * Initializes the ARP layer.
@@ -81,6 +99,7 @@ static struct arp_entry arp_table[ARP_TABLE_SIZE];
 void arp_init()
 {
     memset(arp_table, 0, sizeof(arp_table));
+    memset(arp_pending, 0, sizeof(arp_pending));
 
     int timer = timer_alloc(arp_interval, 0);
     timer_set(timer, 5000);
@@ -100,6 +119,14 @@ void arp_interval(int timer)
             --entry->timeout;
     }
 
+    /* repeat requests for packets still waiting, drop them when timed out */
+    struct arp_pending* pending = &arp_pending[0];
+    for(; pending < &arp_pending[ARP_PENDING_COUNT]; ++pending)
+    {
+        if(pending->timeout > 0 && --pending->timeout > 0)
+            arp_generate_request(pending->ip);
+    }
+
     timer_set(timer, 5000);
 }
 
@@ -116,9 +143,6 @@ bool arp_handle_packet(const struct arp_header* packet, uint16_t packet_len)
     if(packet_len < sizeof(*packet))
         return false;
 
-    /* check if packet is for our ip address */
-    if(memcmp(&packet->dest_ip, ip_get_address(), sizeof(packet->dest_ip)) != 0)
-        return false;
     /* check hardware address type: ethernet */
     if(packet->hardware_address_type != HTON16(ARP_HW_ADDR_TYPE_ETHERNET))
         return false;
@@ -132,6 +156,30 @@ bool arp_handle_packet(const struct arp_header* packet, uint16_t packet_len)
 
     /* check arp operation */
     uint16_t op = packet->operation;
+    if(op != HTON16(ARP_OP_REQUEST) && op != HTON16(ARP_OP_REPLY))
+        return false;
+
+    net_stats_inc(NET_STAT_ARP_RX);
+
+    /* check if packet is for our ip address */
+    if(memcmp(&packet->dest_ip, ip_get_address(), sizeof(packet->dest_ip)) != 0)
+    {
+        /* learn from gratuitous ARP, a host announcing its own address */
+        if(memcmp(packet->source_ip, packet->dest_ip, sizeof(packet->source_ip)) == 0 &&
+           (packet->source_ip[0] | packet->source_ip[1] | packet->source_ip[2] | packet->source_ip[3]) != 0
+          )
+        {
+            arp_insert(packet->source_mac, packet->source_ip);
+            return true;
+        }
+
+        /* otherwise only refresh a host we already know */
+        if(arp_find(packet->source_ip))
+            arp_insert(packet->source_mac, packet->source_ip);
+
+        return false;
+    }
+
     switch(op)
     {
         case HTON16(ARP_OP_REQUEST):
@@ -225,14 +273,15 @@ bool arp_generate_request(const uint8_t* ip)
  */
 void arp_insert(const uint8_t* mac, const uint8_t* ip)
 {
-    /* Search for a free entry. If none is
-     * available, overwrite the oldest one.
+    /* Search the probe window for the host or a free entry.
+     * If none is available, overwrite the oldest one.
      */
-    struct arp_entry* entry = &arp_table[0];
-    struct arp_entry* entry_used = entry;
+    uint8_t index = arp_hash(ip);
+    struct arp_entry* entry_used = &arp_table[index];
     uint16_t timeout_min = 0xffff;
-    for(; entry < &arp_table[ARP_TABLE_SIZE]; ++entry)
+    for(uint8_t i = 0; i < ARP_TABLE_PROBES; ++i, index = (index + 1) & (ARP_TABLE_SIZE - 1))
     {
+        struct arp_entry* entry = &arp_table[index];
         if(memcmp(entry->ip, ip, sizeof(entry->ip)) == 0)
         {
             entry_used = entry;
@@ -251,6 +300,64 @@ void arp_insert(const uint8_t* mac, const uint8_t* ip)
     memcpy(entry_used->ip, ip, sizeof(entry_used->ip));
     /* start timeout */
     entry_used->timeout = ARP_TIMEOUT;
+
+    /* deliver the packets which waited for this host */
+    arp_send_pending(mac, ip);
+}
+
+/**
+ * Searches the ARP table for a valid entry of a host.
+ *
+ * \param[in] ip A pointer to the IP address of the host.
+ * \returns A pointer to the table entry, or \c 0 if the host is unknown.
+ */
+struct arp_entry* arp_find(const uint8_t* ip)
+{
+    uint8_t index = arp_hash(ip);
+    for(uint8_t i = 0; i < ARP_TABLE_PROBES; ++i, index = (index + 1) & (ARP_TABLE_SIZE - 1))
+    {
+        struct arp_entry* entry = &arp_table[index];
+        if(entry->timeout > 0 &&
+           memcmp(entry->ip, ip, sizeof(entry->ip)) == 0
+          )
+            return entry;
+    }
+
+    return 0;
+}
+
+/**
+ * Calculates the ARP table position at which the search for a host starts.
+ *
+ * \param[in] ip A pointer to the IP address of the host.
+ * \returns The index into the ARP table.
+ */
+uint8_t arp_hash(const uint8_t* ip)
+{
+    /* hosts of the local subnet mostly differ in the last byte */
+    return (ip[3] ^ ip[2] ^ (ip[1] << 1) ^ (ip[0] << 2)) & (ARP_TABLE_SIZE - 1);
+}
+
+/**
+ * Sends the packets which waited for the hardware address of a host.
+ *
+ * \param[in] mac A pointer to the 6-byte hardware address of the host.
+ * \param[in] ip A pointer to the 4-byte IP address of the host.
+ */
+void arp_send_pending(const uint8_t* mac, const uint8_t* ip)
+{
+    struct arp_pending* pending = &arp_pending[0];
+    for(; pending < &arp_pending[ARP_PENDING_COUNT]; ++pending)
+    {
+        if(pending->timeout == 0 ||
+           memcmp(pending->ip, ip, sizeof(pending->ip)) != 0
+          )
+            continue;
+
+        pending->timeout = 0;
+        memcpy(ethernet_get_buffer(), pending->data, pending->data_len);
+        ethernet_send_packet(mac, pending->type, pending->data_len);
+    }
 }
 
 /**
@@ -263,22 +370,61 @@ void arp_insert(const uint8_t* mac, const uint8_t* ip)
 bool arp_get_mac(const uint8_t* ip, uint8_t* mac)
 {
     /* search for ip address in arp table */
-    struct arp_entry* entry = &arp_table[0];
-    for(; entry < &arp_table[ARP_TABLE_SIZE]; ++entry)
+    struct arp_entry* entry = arp_find(ip);
+    if(!entry)
+        return false;
+
+    memcpy(mac, entry->mac, sizeof(entry->mac));
+    return true;
+}
+
+/**
+ * Holds the packet in the transmit buffer until the hardware address of a host is known.
+ *
+ * An ARP request is sent unless one is already outstanding for the host.
+ * The packet gets sent as soon as the reply arrives, or dropped after
+ * #ARP_PENDING_TIMEOUT.
+ *
+ * \param[in] ip A pointer to the IP address of the host.
+ * \param[in] type The protocol identifier of the packet payload.
+ * \param[in] data_len The length of the payload which is read from the ethernet transmit buffer.
+ * \returns \c true if the packet is kept, \c false if it has been dropped.
+ */
+bool arp_queue_packet(const uint8_t* ip, uint16_t type, uint16_t data_len)
+{
+    struct arp_pending* pending_free = 0;
+    bool requested = false;
+
+    struct arp_pending* pending = &arp_pending[0];
+    for(; pending < &arp_pending[ARP_PENDING_COUNT]; ++pending)
     {
-        if(entry->timeout > 0 &&
-           memcmp(entry->ip, ip, sizeof(entry->ip)) == 0
-          )
+        if(pending->timeout == 0)
         {
-            memcpy(mac, entry->mac, sizeof(entry->mac));
-            return true;
+            if(!pending_free)
+                pending_free = pending;
         }
+        else if(memcmp(pending->ip, ip, sizeof(pending->ip)) == 0)
+        {
+            requested = true;
+        }
+    }
+
+    bool queued = false;
+    if(pending_free && data_len <= sizeof(pending_free->data))
+    {
+        pending_free->timeout = ARP_PENDING_TIMEOUT;
+        memcpy(pending_free->ip, ip, sizeof(pending_free->ip));
+        pending_free->type = type;
+        pending_free->data_len = data_len;
+        memcpy(pending_free->data, ethernet_get_buffer(), data_len);
+        queued = true;
     }
 
-    /* send ARP request */
-    arp_generate_request(ip);
+    /* the request reuses the transmit buffer, so only now send it */
+    if(!requested)
+        arp_generate_request(ip);
 
-    return false;
+    return queued;
 }
 
 /**
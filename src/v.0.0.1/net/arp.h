@@ -40,6 +40,7 @@ struct arp_header;
 void arp_init();
 bool arp_handle_packet(const struct arp_header* packet, uint16_t packet_len);
 bool arp_get_mac(const uint8_t* ip, uint8_t* mac);
+bool arp_queue_packet(const uint8_t* ip, uint16_t type, uint16_t data_len);
 
 /**
  * @}
@@ -39,8 +39,37 @@
 
 /**
  * The maximum number of ARP table entries.
+ *
+ * \note Must be a power of two, the table is indexed by a hash of the IP address.
+ */
+#define ARP_TABLE_SIZE 32
+
+/**
+ * The number of consecutive table entries searched from the hashed position.
+ *
+ * Lookups never touch more entries than this. When all of them are in use,
+ * the oldest one gets replaced.
+ */
+#define ARP_TABLE_PROBES 4
+
+/**
+ * The number of outgoing packets which can wait for an address to be resolved.
+ */
+#define ARP_PENDING_COUNT 2
+
+/**
+ * The maximum payload size of a packet waiting for address resolution.
+ *
+ * Larger packets are dropped on an ARP miss and left to the higher-level protocols.
+ */
+#define ARP_PENDING_SIZE 576
+
+/**
+ * The time a packet waits for address resolution in units of five seconds.
+ *
+ * The ARP request is repeated every five seconds until then.
  */
-#define ARP_TABLE_SIZE 4
+#define ARP_PENDING_TIMEOUT 2
 
 /**
  * The expiration time of an ARP table entry in units of five seconds.
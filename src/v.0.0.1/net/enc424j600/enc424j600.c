@@ -21,6 +21,7 @@
 #include <util/delay.h>
 
 #include <avr/sfr_defs.h>
+#include <avr/interrupt.h>
 
 
 #include "../../arch/spi.h"
@@ -36,9 +37,57 @@
 // Promiscuous mode, uncomment if you want to receive all packets, even those which are not for you
 //#define PROMISCUOUS_MODE
 
+// Frame layout used by the checksum offload
+#define ETH_HEADER				(14)
+#define IP_PROTOCOL1			(0x08)
+#define IP_PROTOCOL2			(0x00)
+#define IP_PROTOCOL_POS			(23)
+#define IP_ADDRESS_POS			(26)
+#define TCP_PROTOCOL			(6)
+#define UDP_PROTOCOL			(17)
+#define TCP_CHECKSUM_POS		(16)
+#define UDP_CHECKSUM_POS		(6)
+
 // Internal MAC level variables and flags.
 static uint8_t currentBank;
 static uint16_t nextPacketPointer;
+static char rxChecksumVerified;
+
+// Transmit ring, txHead is the oldest frame, on the wire while txBusy is set
+static uint16_t txLength[ENC424J600_TX_SLOTS];
+static uint8_t txHead;
+static uint8_t txCount;
+static char txBusy;
+static void (*txCallback)(char ok);
+
+// Error counter, wrapping around
+static uint16_t rxOverflows;
+
+static void enc424j600TxService(void);
+static void enc424j600RxOverflowCheck(uint16_t eir);
+
+// The echo reply is copied to TXSTART and sent from there, outside the
+// transmit ring, where it would overwrite a frame still queued in slot 0:
+#ifdef AUTO_ICMP_ECHO
+#error "AUTO_ICMP_ECHO does not work with the transmit ring"
+#endif
+
+#ifdef ENC424J600_RX_INTERRUPT
+
+// Header of a received packet, read ahead of its data
+typedef struct {
+	uint16_t address;		// first byte of the packet data
+	uint16_t next;			// next packet pointer
+	RXSTATUS statusVector;
+} RXDESCRIPTOR;
+
+static volatile uint8_t rxPending;
+static RXDESCRIPTOR rxQueue[ENC424J600_RX_DESCRIPTORS];
+static uint8_t rxQueueHead;
+static uint8_t rxQueueCount;
+
+static void enc424j600RxQueueFill(void);
+#endif
 
 static uint16_t enc424j600ReadReg(uint16_t address);
 static void enc424j600WriteReg(uint16_t address, uint16_t data);
@@ -47,6 +96,11 @@ static void enc424j600BFSReg(uint16_t address, uint16_t bitMask);
 static void enc424j600BFCReg(uint16_t address, uint16_t bitMask);
 static void enc424j600WriteN(uint8_t op, uint8_t* data, uint16_t dataLen);
 static void enc424j600ReadN(uint8_t op, uint8_t* data, uint16_t dataLen);
+#ifdef ENC424J600_CHECKSUM_OFFLOAD
+static uint16_t enc424j600UpperLayerLength(uint8_t* packet, uint16_t len);
+static void enc424j600ChecksumInsert(uint8_t* packet, uint16_t len, uint16_t address);
+static char enc424j600ChecksumVerify(uint8_t* packet, uint16_t len, uint16_t address);
+#endif
 
 /********************************************************************
  * INITIALIZATION
@@ -59,13 +113,19 @@ void enc424j600Init(uint8_t *mac_addr)
 
 
 
+	// the scheduler may already run jobs of the other devices
+	spi_bus_lock();
 	enc424j600_spi_set();
+	spi_bus_unlock();
 
 	// Perform a reliable reset
 	enc424j600SendSystemReset();
 
 	// Initialize RX tracking variables and other control state flags
 	nextPacketPointer = RXSTART;
+	txHead = 0;
+	txCount = 0;
+	txBusy = 0;
 
 	// Set up TX/RX/UDA buffer addresses
 	enc424j600WriteReg(ETXST, TXSTART);
@@ -96,6 +156,15 @@ void enc424j600Init(uint8_t *mac_addr)
 	// and symmetric PAUSE capability
 	enc424j600WritePHYReg(PHANA, PHANA_ADPAUS0 | PHANA_AD10FD | PHANA_AD10 | PHANA_AD100FD | PHANA_AD100 | PHANA_ADIEEE0);
 
+#ifdef ENC424J600_RX_INTERRUPT
+	// Assert INT while received packets are pending
+	rxPending = 0;
+	rxQueueHead = 0;
+	rxQueueCount = 0;
+	enc424j600WriteReg(EIE, EIE_INTIE | EIE_PKTIE);
+	enc424j600_int_set();
+#endif
+
 	// Enable RX packet reception
 	enc424j600BFSReg(ECON1, ECON1_RXEN);
 }
@@ -149,12 +218,46 @@ char enc424j600MACIsTxReady(void)
 	return !( ECON1_TXRTS & enc424j600ReadReg(ECON1) );
 }
 
+/**
+ * Queues a frame for transmission
+ * The frame is copied into a free transmit slot and the function returns
+ * without waiting for the wire, unless all slots are still taken.
+ * @variable <uint8_t*> packet - ethernet frame, free for reuse on return
+ * @variable <uint16_t> len - frame length
+ * @return <char>
+ */
 char enc424j600PacketSend(uint8_t* packet, uint16_t len)
 {
+	return enc424j600PacketSendData(packet, len, 0, 0);
+}
+
+/**
+ * Queues a frame whose payload continues in a separate buffer
+ * Both parts are written one after the other into the transmit slot.
+ * @variable <uint8_t*> packet - ethernet and protocol headers, at least up to the IP header
+ * @variable <uint16_t> len - length of packet
+ * @variable <const uint8_t*> data - rest of the frame, free for reuse on return
+ * @variable <uint16_t> dataLen - length of data
+ * @return <char>
+ */
+char enc424j600PacketSendData(uint8_t* packet, uint16_t len, const uint8_t* data, uint16_t dataLen)
+{
+	if (len + dataLen > ENC424J600_TX_SLOT_SIZE) {
+		return 0;
+	}
+
 	spi_high_frequency();
 
-	// Set the Window Write Pointer to the beginning of the transmit buffer
-	enc424j600WriteReg(EGPWRPT, TXSTART);
+	// Retire finished frames, wait for the wire only if the ring is full
+	do {
+		enc424j600TxService();
+	} while (txCount == ENC424J600_TX_SLOTS);
+
+	uint8_t slot = (txHead + txCount) % ENC424J600_TX_SLOTS;
+	uint16_t address = TXSTART + slot * ENC424J600_TX_SLOT_SIZE;
+
+	// Set the Window Write Pointer to the beginning of the transmit slot
+	enc424j600WriteReg(EGPWRPT, address);
 
 #ifdef HARDWARE_CHECKSUM_NULL
 	// Is it the IP packet? If so, for sure null checksum a let hardware to compute it
@@ -180,62 +283,113 @@ char enc424j600PacketSend(uint8_t* packet, uint16_t len)
 #endif
 
 	enc424j600WriteMemoryWindow(GP_WINDOW, packet, len);
-
-#ifdef HARDWARE_CHECKSUM
-	// Is it the IP packet? Get it computed by hardware
-	if (packet[12] == IP_PROTOCOL1 && packet[13] == IP_PROTOCOL2) {
-		//Compute header length
-		uint8_t headerLen = (packet[ETH_HEADER] & 15)*4;
-		//Compute checksum of IP header
-		uint16_t checksum = enc424j600ChecksumCalculation(ETH_HEADER, headerLen, 0x0000);
-		//Write it to correct position
-		enc424j600WriteReg(EGPWRPT, 24);
-		enc424j600WriteMemoryWindow(GP_WINDOW, ((uint8_t*) & checksum), 2);
-
-		//we can also compute icmp/tcp/udp messages
-		if (packet[IP_PROTOCOL_POS] == ICMP_PROTOCOL) { /*ICMP*/
-			//Compute header length
-			uint8_t icmpLen = len - headerLen - ETH_HEADER;
-			//Compute checksum of ICMP
-			checksum = enc424j600ChecksumCalculation(ETH_HEADER + headerLen, icmpLen, 0x0000);
-			//Write it to correct position
-			enc424j600WriteReg(EGPWRPT, 36);
-			enc424j600WriteMemoryWindow(GP_WINDOW, ((uint8_t*) & checksum), 2);
-		} else if (packet[IP_PROTOCOL_POS] == TCP_PROTOCOL || packet[IP_PROTOCOL_POS] == UDP_PROTOCOL) { /*TCP or UDP*/
-			//Compute header length
-			uint16_t upperLayerLen = len - headerLen - ETH_HEADER;
-
-			//Compute checksum of TCP or UDP
-			checksum = ~(HTONS(packet[IP_PROTOCOL_POS] + upperLayerLen)); //HTONS macro is from uIP
-			checksum = enc424j600ChecksumCalculation(26, 8, checksum);
-			checksum = enc424j600ChecksumCalculation(ETH_HEADER + headerLen, upperLayerLen, checksum);
-
-			//Write it to correct position
-			if (packet[IP_PROTOCOL_POS] == TCP_PROTOCOL) {
-				enc424j600WriteReg(EGPWRPT, 50);
-			} else {
-				enc424j600WriteReg(EGPWRPT, 40);
-			}
-			enc424j600WriteMemoryWindow(GP_WINDOW, ((uint8_t*) & checksum), 2);
-		}
+	if (dataLen) {
+		enc424j600WriteMemoryWindow(GP_WINDOW, (uint8_t*) data, dataLen);
 	}
+	len += dataLen;
+
+#ifdef ENC424J600_CHECKSUM_OFFLOAD
+	enc424j600ChecksumInsert(packet, len, address);
 #endif
 
-	enc424j600WriteReg(ETXLEN, len);
+	txLength[slot] = len;
+	++txCount;
 
-	enc424j600MACFlush();
+	// Starts the frame right away if the wire is idle
+	enc424j600TxService();
 
 	return 1;
 }
 
+/**
+ * Sets the function called for every frame which left the transmit ring
+ * @variable <void (*)(char)> callback - gets 1 if the frame was sent, 0 if it was aborted
+ */
+void enc424j600SetTxCallback(void (*callback)(char ok))
+{
+	txCallback = callback;
+}
+
+/**
+ * Retires the frame on the wire once it is done and starts the next queued one
+ */
+static void enc424j600TxService(void)
+{
+	if (txBusy) {
+		if (enc424j600ReadReg(ECON1) & ECON1_TXRTS) {
+			return;
+		}
+		txBusy = 0;
+
+		char ok = !(enc424j600ReadReg(EIR) & EIR_TXABTIF);
+		enc424j600BFCReg(EIR, EIR_TXIF | EIR_TXABTIF);
+
+		txHead = (txHead + 1) % ENC424J600_TX_SLOTS;
+		--txCount;
+
+		if (txCallback) {
+			txCallback(ok);
+		}
+	}
+
+	if (txCount) {
+		enc424j600WriteReg(ETXST, TXSTART + txHead * ENC424J600_TX_SLOT_SIZE);
+		enc424j600WriteReg(ETXLEN, txLength[txHead]);
+		enc424j600MACFlush();
+		txBusy = 1;
+	}
+}
+
 uint16_t enc424j600PacketReceive(uint8_t* packet, uint16_t len)
 {
 	uint16_t newRXTail;
 	RXSTATUS statusVector;
 
+	rxChecksumVerified = 0;
+
+#ifdef ENC424J600_RX_INTERRUPT
+	// Frames waiting for the wire are polled as no TX interrupt is enabled
+	if (txCount) {
+		spi_high_frequency();
+		enc424j600TxService();
+	}
+
+	if (!rxQueueCount) {
+		// Nothing announced by the INT line, leave the SPI bus alone
+		if (!rxPending && (ENC424J600_INT_PIN & ENC424J600_INT_bm)) {
+			return 0;
+		}
+		rxPending = 0;
+
+		spi_high_frequency();
+		enc424j600RxQueueFill();
+		if (!rxQueueCount) {
+			return 0;
+		}
+	}
+
+	spi_high_frequency();
+
+	RXDESCRIPTOR* descriptor = &rxQueue[rxQueueHead];
+	rxQueueHead = (rxQueueHead + 1) % ENC424J600_RX_DESCRIPTORS;
+	--rxQueueCount;
+
+	uint16_t packetAddress = descriptor->address;
+	uint16_t packetNext = descriptor->next;
+	statusVector = descriptor->statusVector;
+
+	// Header already read, go straight to the packet data
+	enc424j600WriteReg(ERXRDPT, packetAddress);
+#else
 	spi_high_frequency();
 
-	if(!(enc424j600ReadReg(EIR) & EIR_PKTIF)) {
+	if (txCount) {
+		enc424j600TxService();
+	}
+
+	uint16_t eir = enc424j600ReadReg(EIR);
+	enc424j600RxOverflowCheck(eir);
+	if(!(eir & EIR_PKTIF)) {
 		return 0;
 	}
 
@@ -338,15 +492,27 @@ uint16_t enc424j600PacketReceive(uint8_t* packet, uint16_t len)
 	// Set the RX Read Pointer to the beginning of the next unprocessed packet
 	enc424j600WriteReg(ERXRDPT, nextPacketPointer);
 
+	// Packet data follows the next packet pointer and the status vector
+	uint16_t packetAddress = nextPacketPointer + sizeof (nextPacketPointer) + sizeof (statusVector);
+
 	enc424j600ReadMemoryWindow(RX_WINDOW, (uint8_t*) & nextPacketPointer, sizeof (nextPacketPointer));
 
 	enc424j600ReadMemoryWindow(RX_WINDOW, (uint8_t*) & statusVector, sizeof (statusVector));
+
+	uint16_t packetNext = nextPacketPointer;
+#endif
+
 	len = (statusVector.bits.ByteCount <= len+4) ? statusVector.bits.ByteCount-4 : 0;
 	enc424j600ReadMemoryWindow(RX_WINDOW, packet, len);
 
-	newRXTail = nextPacketPointer - 2;
+#ifdef ENC424J600_CHECKSUM_OFFLOAD
+	// Verify while the packet is still owned by us, before moving the RX tail
+	rxChecksumVerified = enc424j600ChecksumVerify(packet, len, packetAddress);
+#endif
+
+	newRXTail = packetNext - 2;
 	//Special situation if nextPacketPointer is exactly RXSTART
-	if (nextPacketPointer == RXSTART)
+	if (packetNext == RXSTART)
 		newRXTail = RAMSIZE - 2;
 
 	//Packet decrement
@@ -358,6 +524,203 @@ uint16_t enc424j600PacketReceive(uint8_t* packet, uint16_t len)
 	return len;
 }
 
+#ifdef ENC424J600_RX_INTERRUPT
+/**
+ * INT line asserted, a packet has arrived
+ * No SPI access here, the bus may be in use by the main loop.
+ */
+ISR(ENC424J600_INT_vect)
+{
+	rxPending = 1;
+}
+
+/**
+ * Reads the headers of the pending packets into the descriptor queue
+ * The packets stay in the RX buffer until enc424j600PacketReceive() fetches them.
+ */
+static void enc424j600RxQueueFill(void)
+{
+	enc424j600RxOverflowCheck(enc424j600ReadReg(EIR));
+
+	// PKTCNT includes the packets already queued
+	uint8_t packets = enc424j600ReadReg(ESTAT) & 0xFF;
+	packets -= rxQueueCount;
+
+	while (packets-- && rxQueueCount < ENC424J600_RX_DESCRIPTORS) {
+		RXDESCRIPTOR* descriptor = &rxQueue[(rxQueueHead + rxQueueCount) % ENC424J600_RX_DESCRIPTORS];
+
+		enc424j600WriteReg(ERXRDPT, nextPacketPointer);
+		enc424j600ReadMemoryWindow(RX_WINDOW, (uint8_t*) & descriptor->next, sizeof (descriptor->next));
+		enc424j600ReadMemoryWindow(RX_WINDOW, (uint8_t*) & descriptor->statusVector, sizeof (descriptor->statusVector));
+
+		// Packet data follows the header, wrapping around the end of the RX buffer
+		descriptor->address = nextPacketPointer + sizeof (descriptor->next) + sizeof (descriptor->statusVector);
+		if (descriptor->address >= RAMSIZE) {
+			descriptor->address -= RAMSIZE - RXSTART;
+		}
+
+		nextPacketPointer = descriptor->next;
+		++rxQueueCount;
+	}
+}
+#endif
+
+/**
+ * Counts a receive abort flagged in EIR and clears it
+ * Each count stands for one or more packets dropped since the previous check.
+ * @variable <uint16_t> eir - value just read from EIR
+ */
+static void enc424j600RxOverflowCheck(uint16_t eir)
+{
+	if (eir & (EIR_RXABTIF | EIR_PCFULIF)) {
+		++rxOverflows;
+		enc424j600BFCReg(EIR, EIR_RXABTIF | EIR_PCFULIF);
+	}
+}
+
+/**
+ * Number of times received packets were dropped because the RX buffer was full
+ * @return <uint16_t> - overflow count, wrapping around
+ */
+uint16_t enc424j600GetRxOverflows(void)
+{
+	return rxOverflows;
+}
+
+/**
+ * Was the TCP/UDP checksum of the last received packet verified by hardware?
+ * @return <char> - 1 if it is correct, 0 if it still has to be checked
+ */
+char enc424j600PacketChecksumVerified(void)
+{
+	return rxChecksumVerified;
+}
+
+/**
+ * Computes a checksum over controller memory with the DMA engine
+ * @variable <uint16_t> address - start address in controller SRAM
+ * @variable <uint16_t> length - number of bytes
+ * @variable <uint16_t> seed - result of a previous calculation to continue, 0 to start
+ * @return <uint16_t> - inverted checksum, in memory byte order
+ */
+uint16_t enc424j600ChecksumCalculation(uint16_t address, uint16_t length, uint16_t seed)
+{
+	// Wait until a previous DMA operation is done
+	while (enc424j600ReadReg(ECON1) & ECON1_DMAST) {
+	}
+
+	enc424j600BFCReg(ECON1, ECON1_DMACPY | ECON1_DMANOCS);
+	enc424j600WriteReg(EDMAST, address);
+	enc424j600WriteReg(EDMALEN, length);
+
+	if (seed) {
+		enc424j600WriteReg(EDMACS, seed);
+		enc424j600BFSReg(ECON1, ECON1_DMACSSD);
+	} else {
+		enc424j600BFCReg(ECON1, ECON1_DMACSSD);
+	}
+
+	enc424j600BFSReg(ECON1, ECON1_DMAST); // Wait until done
+	while (enc424j600ReadReg(ECON1) & ECON1_DMAST) {
+	}
+
+	return enc424j600ReadReg(EDMACS);
+}
+
+#ifdef ENC424J600_CHECKSUM_OFFLOAD
+/**
+ * Gets the length of the TCP or UDP part of an IP packet
+ * @variable <uint8_t*> packet - ethernet frame
+ * @variable <uint16_t> len - frame length
+ * @return <uint16_t> - TCP/UDP length, 0 if no TCP/UDP packet or inconsistent
+ */
+static uint16_t enc424j600UpperLayerLength(uint8_t* packet, uint16_t len)
+{
+	if (len < ETH_HEADER + 20 || packet[12] != IP_PROTOCOL1 || packet[13] != IP_PROTOCOL2) {
+		return 0;
+	}
+
+	if (packet[IP_PROTOCOL_POS] != TCP_PROTOCOL && packet[IP_PROTOCOL_POS] != UDP_PROTOCOL) {
+		return 0;
+	}
+
+	uint8_t headerLen = (packet[ETH_HEADER] & 15)*4;
+	uint16_t ipLen = (uint16_t) packet[ETH_HEADER + 2] << 8 | packet[ETH_HEADER + 3];
+
+	if (ipLen <= headerLen || ETH_HEADER + ipLen > len) {
+		return 0;
+	}
+
+	return ipLen - headerLen;
+}
+
+/**
+ * Completes the TCP/UDP checksum of the frame in the transmit buffer
+ * The protocol layer puts the pseudo header checksum into the checksum field,
+ * so summing up the TCP/UDP part gives the final value.
+ * @variable <uint8_t*> packet - ethernet frame, already written to the transmit slot
+ * @variable <uint16_t> len - frame length
+ * @variable <uint16_t> address - address of the transmit slot
+ */
+static void enc424j600ChecksumInsert(uint8_t* packet, uint16_t len, uint16_t address)
+{
+	uint16_t upperLayerLen = enc424j600UpperLayerLength(packet, len);
+	if (!upperLayerLen) {
+		return;
+	}
+
+	uint16_t upperLayerPos = ETH_HEADER + (packet[ETH_HEADER] & 15)*4;
+	uint16_t checksum = enc424j600ChecksumCalculation(address + upperLayerPos, upperLayerLen, 0x0000);
+
+	//Write it to correct position
+	if (packet[IP_PROTOCOL_POS] == TCP_PROTOCOL) {
+		enc424j600WriteReg(EGPWRPT, address + upperLayerPos + TCP_CHECKSUM_POS);
+	} else {
+		// UDP transmits a zero checksum as all ones
+		if (!checksum) {
+			checksum = 0xFFFF;
+		}
+		enc424j600WriteReg(EGPWRPT, address + upperLayerPos + UDP_CHECKSUM_POS);
+	}
+	enc424j600WriteMemoryWindow(GP_WINDOW, ((uint8_t*) & checksum), 2);
+}
+
+/**
+ * Verifies the TCP/UDP checksum of a received frame still in the RX buffer
+ * @variable <uint8_t*> packet - copy of the frame
+ * @variable <uint16_t> len - frame length
+ * @variable <uint16_t> address - address of the frame in the RX buffer
+ * @return <char> - 1 if the checksum is correct, 0 if unknown
+ */
+static char enc424j600ChecksumVerify(uint8_t* packet, uint16_t len, uint16_t address)
+{
+	uint16_t upperLayerLen = enc424j600UpperLayerLength(packet, len);
+	if (!upperLayerLen) {
+		return 0;
+	}
+
+	// Pseudo header sum, cheap enough in software
+	uint32_t sum = packet[IP_PROTOCOL_POS] + upperLayerLen;
+	for (uint8_t i = IP_ADDRESS_POS; i < IP_ADDRESS_POS + 8; i += 2) {
+		sum += (uint16_t) packet[i] << 8 | packet[i + 1];
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	// The TCP/UDP part may wrap around the end of the RX buffer, the DMA follows it
+	address += ETH_HEADER + (packet[ETH_HEADER] & 15)*4;
+	if (address >= RAMSIZE) {
+		address -= RAMSIZE - RXSTART;
+	}
+
+	// The packet is correct if the inverted sum of its TCP/UDP part equals
+	// the pseudo header sum. Anything else is left to the protocol layer.
+	uint16_t checksum = enc424j600ChecksumCalculation(address, upperLayerLen, 0x0000);
+	return (uint16_t) (checksum << 8 | checksum >> 8) == sum;
+}
+#endif
+
 void enc424j600MACFlush(void)
 {
 	uint16_t w;
@@ -531,42 +894,89 @@ void enc424j600WritePHYReg(uint8_t address, uint16_t Data)
 	while (enc424j600ReadReg(MISTAT) & MISTAT_BUSY);
 }
 
-static void enc424j600ReadN(uint8_t op, uint8_t* data, uint16_t dataLen)
+/**
+ * Select the chip for one SPI transaction
+ * The bus is claimed per transaction, the jobs of the other devices
+ * (e.g. the urgent DAC update) run between two transactions.
+ */
+static void enc424j600Select(void)
 {
+	spi_bus_lock();
 	select_net_chip();
+}
 
-	// issue read command
-	SPDR = op;
-	// wail until all is sent
-	while (!(SPSR & (1 << SPIF)));
+/**
+ * Deselect the chip and give the bus back
+ */
+static void enc424j600Unselect(void)
+{
+	unselect_net_chip();
+	spi_bus_unlock();
+}
 
-	while (dataLen--) {
-		// wait for answer
-		SPDR = 0x00;
-		while(!(SPSR & (1 << SPIF)));
-		*data++ = SPDR;
-	}
+/**
+ * Read from a buffer memory window in bursts of ENC424J600_SPI_BURST bytes
+ * The window pointer auto-increments, every burst issues the command again.
+ * @variable <uint8_t> op - SPI operation
+ * @variable <uint8_t*> data - destination
+ * @variable <uint16_t> dataLen - number of bytes
+ */
+static void enc424j600ReadN(uint8_t op, uint8_t* data, uint16_t dataLen)
+{
+	uint8_t burst;
 
-	unselect_net_chip();
+	do {
+		burst = dataLen > ENC424J600_SPI_BURST ? ENC424J600_SPI_BURST : dataLen;
+		dataLen -= burst;
+
+		enc424j600Select();
+
+		// issue read command
+		SPDR = op;
+		// wail until all is sent
+		while (!(SPSR & (1 << SPIF)));
+
+		while (burst--) {
+			// wait for answer
+			SPDR = 0x00;
+			while(!(SPSR & (1 << SPIF)));
+			*data++ = SPDR;
+		}
+
+		enc424j600Unselect();
+	} while (dataLen);
 }
 
+/**
+ * Write to a buffer memory window in bursts of ENC424J600_SPI_BURST bytes
+ * @variable <uint8_t> op - SPI operation
+ * @variable <uint8_t*> data - source
+ * @variable <uint16_t> dataLen - number of bytes
+ */
 static void enc424j600WriteN(uint8_t op, uint8_t* data, uint16_t dataLen)
 {
-	select_net_chip();
+	uint8_t burst;
 
-	// issue read command
-	SPDR = op;
-	// wail until all is sent
-	while(!(SPSR & (1 << SPIF)));
-	
-	while(dataLen--) {
-		// start sending data to SPI
-		SPDR = *data++;
+	do {
+		burst = dataLen > ENC424J600_SPI_BURST ? ENC424J600_SPI_BURST : dataLen;
+		dataLen -= burst;
+
+		enc424j600Select();
+
+		// issue write command
+		SPDR = op;
 		// wail until all is sent
-		while (!(SPSR & (1 << SPIF)));
-	}
-	
-	unselect_net_chip();
+		while(!(SPSR & (1 << SPIF)));
+
+		while(burst--) {
+			// start sending data to SPI
+			SPDR = *data++;
+			// wail until all is sent
+			while (!(SPSR & (1 << SPIF)));
+		}
+
+		enc424j600Unselect();
+	} while (dataLen);
 }
 
 static void enc424j600BFSReg(uint16_t address, uint16_t bitMask)
@@ -624,7 +1034,7 @@ static void enc424j600ExecuteOp0(uint8_t op)
 {
 	uint8_t dummy;
 
-	select_net_chip();
+	enc424j600Select();
 
 	// issue read command
 	SPDR = op;
@@ -633,7 +1043,7 @@ static void enc424j600ExecuteOp0(uint8_t op)
 	// read answer
 	dummy = SPDR;
 
-	unselect_net_chip();
+	enc424j600Unselect();
 }
 
 /**
@@ -645,7 +1055,7 @@ uint8_t enc424j600ExecuteOp8(uint8_t op, uint8_t data)
 {
 	uint8_t returnValue;
 
-	select_net_chip();
+	enc424j600Select();
 
 	// issue write command
 	SPDR = op;
@@ -658,7 +1068,7 @@ uint8_t enc424j600ExecuteOp8(uint8_t op, uint8_t data)
 	// read answer
 	returnValue = SPDR;
 
-	unselect_net_chip();
+	enc424j600Unselect();
 
 	return returnValue;
 }
@@ -672,7 +1082,7 @@ uint16_t enc424j600ExecuteOp16(uint8_t op, uint16_t data)
 {
 	uint16_t x, returnValue;
 
-	select_net_chip();
+	enc424j600Select();
 
 	// issue write command
 	SPDR = op;
@@ -689,7 +1099,7 @@ uint16_t enc424j600ExecuteOp16(uint8_t op, uint16_t data)
 		((uint8_t*) & returnValue)[x] = SPDR;
 	}
 
-	unselect_net_chip();
+	enc424j600Unselect();
 
 	return returnValue;
 }
@@ -703,7 +1113,7 @@ uint32_t enc424j600ExecuteOp32(uint8_t op, uint32_t data)
 {
 	uint32_t returnValue;
 
-	select_net_chip();
+	enc424j600Select();
 
 	// issue write command
 	SPDR = op;
@@ -719,7 +1129,7 @@ uint32_t enc424j600ExecuteOp32(uint8_t op, uint32_t data)
 		((uint8_t*) & returnValue)[x] = SPDR;
 	}
 
-	unselect_net_chip();
+	enc424j600Unselect();
 
 	return returnValue;
 }
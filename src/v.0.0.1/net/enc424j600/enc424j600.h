@@ -766,7 +766,26 @@ typedef union __attribute__((aligned(2), packed)) {
 // ENC424J600 config
 #define RAMSIZE			 (0x6000)
 #define TXSTART			 (0x0000)
-#define RXSTART			 (0x0600)	// Should be an even memory address
+// Transmit ring, a frame is staged in the next slot while the previous one is on the wire
+#define ENC424J600_TX_SLOTS			(3)
+#define ENC424J600_TX_SLOT_SIZE		(0x0600)	// Holds a full frame, should be even
+#define RXSTART			 (TXSTART + ENC424J600_TX_SLOTS * ENC424J600_TX_SLOT_SIZE)	// Should be an even memory address
+// Compute and verify TCP/UDP checksums with the DMA engine, comment out to leave them to software
+#define ENC424J600_CHECKSUM_OFFLOAD
+// Interrupt driven receive over the INT line (CPU_NET_INT, PE7/INT7), comment out to poll EIR
+#define ENC424J600_RX_INTERRUPT
+#define ENC424J600_RX_DESCRIPTORS	(4)	// Packets whose header is read ahead
+#define ENC424J600_INT_vect			INT7_vect
+#define ENC424J600_INT_PIN			PINE
+#define ENC424J600_INT_bm			(1<<PE7)
+// Longest buffer memory transfer under one chip select, bounds the time the SPI bus is held
+#define ENC424J600_SPI_BURST		(64)
+// Falling edge of INT7, the controller pulls the line low while an enabled flag is set
+#define enc424j600_int_set()	{									\
+	EICRB = ( EICRB & ~( 1<<ISC70 ) ) | 1<<ISC71;					\
+	EIFR = 1<<INTF7;												\
+	EIMSK |= 1<<INT7;												\
+}
 ///////////////////////////////////////////////////////////////////////////////////////////
 // ENC424J600 SPI port
 /*#define ENC424J600_SPI_DDR				DDRB
@@ -815,7 +834,12 @@ void enc424j600SendSystemReset(void);
 void enc424j600Init(uint8_t *mac_addr);
 
 char enc424j600PacketSend(uint8_t* packet, uint16_t len);
+char enc424j600PacketSendData(uint8_t* packet, uint16_t len, const uint8_t* data, uint16_t dataLen);
+void enc424j600SetTxCallback(void (*callback)(char ok));
 uint16_t enc424j600PacketReceive(uint8_t* packet, uint16_t maxlen);
+char enc424j600PacketChecksumVerified(void);
+uint16_t enc424j600GetRxOverflows(void);
+uint16_t enc424j600ChecksumCalculation(uint16_t address, uint16_t length, uint16_t seed);
 
 uint16_t enc424j600ReadPHYReg(uint8_t address);
 void enc424j600WritePHYReg(uint8_t address, uint16_t Data);
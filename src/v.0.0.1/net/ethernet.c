@@ -15,6 +15,7 @@
 #include "hal.h"
 #include "ip.h"
 #include "net.h"
+#include "net_stats.h"
 
 /**
  * \addtogroup net
@@ -86,6 +87,8 @@ bool ethernet_handle_packet()
     uint8_t* data = (uint8_t*) (header + 1);
     packet_size -= NET_HEADER_SIZE_ETHERNET; /* drop ethernet header */
 
+    net_stats_inc(NET_STAT_ETH_RX);
+
     switch(header->type_length)
     {
         case HTON16(ETHERNET_FRAME_TYPE_ARP):
@@ -95,6 +98,7 @@ bool ethernet_handle_packet()
             ip_handle_packet((struct ip_header*) data, packet_size);
             break;
         default:
+            net_stats_inc(NET_STAT_ETH_RX_UNKNOWN);
             break;
     }
 
@@ -111,7 +115,25 @@ bool ethernet_handle_packet()
  */
 bool ethernet_send_packet(const uint8_t* mac_dest, uint16_t type, uint16_t data_len)
 {
-    if(data_len > sizeof(ethernet_rx_buffer) - NET_HEADER_SIZE_ETHERNET)
+    return ethernet_send_packet_data(mac_dest, type, data_len, 0, 0);
+}
+
+/**
+ * Sends a packet whose payload starts in the transmit buffer and continues in a separate buffer.
+ *
+ * The trailing part is handed to the network hardware as it is, without
+ * copying it into the transmit buffer.
+ *
+ * \param[in] mac_dest The six byte ethernet address of the remote host to which the packet gets sent.
+ * \param[in] type The protocol identifier of the upper layer protocol.
+ * \param[in] header_len The length of the leading payload part which is read from the global transmit buffer.
+ * \param[in] data A pointer to the trailing payload part.
+ * \param[in] data_len The length of the trailing payload part.
+ * \returns \c true on success, \c false on failure.
+ */
+bool ethernet_send_packet_data(const uint8_t* mac_dest, uint16_t type, uint16_t header_len, const uint8_t* data, uint16_t data_len)
+{
+    if(header_len + data_len > sizeof(ethernet_tx_buffer) - NET_HEADER_SIZE_ETHERNET)
         return false;
 
     struct ethernet_header* header = (struct ethernet_header*) ethernet_tx_buffer;
@@ -119,7 +141,14 @@ bool ethernet_send_packet(const uint8_t* mac_dest, uint16_t type, uint16_t data_
     memcpy(header->source, ethernet_mac, 6);
     header->type_length = hton16(type);
 
-    return hal_send_packet((uint8_t*) header, data_len + NET_HEADER_SIZE_ETHERNET);
+    bool sent;
+    if(data_len < 1)
+        sent = hal_send_packet((uint8_t*) header, header_len + NET_HEADER_SIZE_ETHERNET);
+    else
+        sent = hal_send_packet_data((uint8_t*) header, header_len + NET_HEADER_SIZE_ETHERNET, data, data_len);
+
+    net_stats_inc(sent ? NET_STAT_ETH_TX : NET_STAT_ETH_TX_ERRORS);
+    return sent;
 }
 
 /**
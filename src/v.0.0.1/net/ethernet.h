@@ -48,6 +48,7 @@ extern uint8_t ethernet_tx_buffer[];
 bool ethernet_handle_packet();
 void ethernet_init(const uint8_t* mac);
 bool ethernet_send_packet(const uint8_t* mac_dest, uint16_t type, uint16_t data_len);
+bool ethernet_send_packet_data(const uint8_t* mac_dest, uint16_t type, uint16_t header_len, const uint8_t* data, uint16_t data_len);
 
 const uint8_t* ethernet_get_mac();
 
@@ -13,9 +13,11 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-
-
+#ifdef HAL_TAP
+#include "tap/tap.h"
+#else
 #include "enc424j600/enc424j600.h"
+#endif
 
 /**
  * \addtogroup net
@@ -28,6 +30,9 @@
  * This compile-time configuration module links the network protocol
  * stack with the driver of the hardware chipset.
  *
+ * The board uses the ENC424J600. Defining \c HAL_TAP selects the Linux
+ * TAP/pcap driver instead, which runs the stack as a host process.
+ *
  * @{
  */
 /**
@@ -43,7 +48,11 @@
  * \param[in] mac A pointer to a 6-byte buffer containing the network mac address.
  * \returns TRUE on success, FALSE on failure.
  */
+#ifdef HAL_TAP
+#define hal_init(mac) tap_init(mac)
+#else
 #define hal_init(mac) enc424j600Init(mac)
+#endif
 
 /**
  * Fetches the next ethernet packet from the device.
@@ -61,7 +70,11 @@
  * \param[in] buffer_len The length of the buffer.
  * \returns The packet size in bytes on success, \c 0 in the cases noted above.
  */
+#ifdef HAL_TAP
+#define hal_receive_packet(buffer, buffer_len) tap_receive_packet(buffer, buffer_len)
+#else
 #define hal_receive_packet(buffer, buffer_len) enc424j600PacketReceive(buffer, buffer_len)
+#endif
 
 
 /**
@@ -71,11 +84,60 @@
  * If the CRC cannot be generated by the network hardware, it has to be calculated
  * by the driver.
  *
+ * The driver may queue the packet and return before it is on the wire, the
+ * buffer can be reused as soon as the call returns.
+ *
  * \param[in] buffer A pointer to the buffer containing the packet to be sent.
  * \param[in] buffer_len The length of the ethernet packet header plus payload.
  * \returns TRUE if the packet was sent, FALSE otherwise.
  */
+#ifdef HAL_TAP
+#define hal_send_packet(buffer, buffer_len) tap_send_packet(buffer, buffer_len)
+#else
 #define hal_send_packet(buffer, buffer_len) enc424j600PacketSend(buffer, buffer_len)
+#endif
+
+/**
+ * Sends an ethernet packet whose payload continues in a separate buffer.
+ *
+ * The device gets \c buffer_len bytes from \c buffer followed by \c data_len
+ * bytes from \c data, without copying them together first. Otherwise this
+ * behaves like hal_send_packet().
+ *
+ * \param[in] buffer A pointer to the ethernet packet header and the leading part of the payload.
+ * \param[in] buffer_len The length of the leading part.
+ * \param[in] data A pointer to the trailing part of the payload.
+ * \param[in] data_len The length of the trailing part.
+ * \returns TRUE if the packet was sent, FALSE otherwise.
+ */
+#ifdef HAL_TAP
+#define hal_send_packet_data(buffer, buffer_len, data, data_len) tap_send_packet_data(buffer, buffer_len, data, data_len)
+#else
+#define hal_send_packet_data(buffer, buffer_len, data, data_len) enc424j600PacketSendData(buffer, buffer_len, data, data_len)
+#endif
+
+
+/**
+ * Defined if the network hardware completes the checksums of TCP and UDP packets.
+ *
+ * The protocol layers then only put the pseudo header checksum into the
+ * checksum field of outgoing packets, and skip testing the checksum of
+ * incoming packets which the driver already verified.
+ */
+#if !defined(HAL_TAP) && defined(ENC424J600_CHECKSUM_OFFLOAD)
+#define HAL_CHECKSUM_OFFLOAD
+#endif
+
+/**
+ * Checks wether the driver verified the TCP or UDP checksum of the packet fetched last.
+ *
+ * \returns \c TRUE if the checksum is known to be correct, \c FALSE if it still has to be tested.
+ */
+#ifdef HAL_CHECKSUM_OFFLOAD
+#define hal_checksum_verified()	enc424j600PacketChecksumVerified()
+#else
+#define hal_checksum_verified()	0
+#endif
 
 
 /**
@@ -83,7 +145,38 @@
  *
  * \returns \c TRUE if the network link is and has been up, \c FALSE otherwise.
  */
+#ifdef HAL_TAP
+#define hal_link_up()	tap_link_up()
+#else
 #define hal_link_up()	enc424j600MACIsLinked()
+#endif
+
+
+/**
+ * Retrieves the number of packets the device dropped because its receive buffer was full.
+ *
+ * \returns The number of receive buffer overflows, wrapping around at 16 bits.
+ */
+#ifdef HAL_TAP
+#define hal_rx_overflows()	0
+#else
+#define hal_rx_overflows()	enc424j600GetRxOverflows()
+#endif
+
+/**
+ * Sets the function which is called when a queued packet has left the device.
+ *
+ * The callback runs from the main loop, within one of the hal_*() calls,
+ * and gets nonzero if the packet was sent or zero if it was aborted. The
+ * TAP driver hands packets to the host right away and never calls it.
+ *
+ * \param[in] callback The function of type \c void \c (*)(char ok), or \c NULL.
+ */
+#ifdef HAL_TAP
+#define hal_set_tx_callback(callback)	((void) (callback))
+#else
+#define hal_set_tx_callback(callback)	enc424j600SetTxCallback(callback)
+#endif
 
 
 /**
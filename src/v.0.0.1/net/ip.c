@@ -14,6 +14,7 @@
 #include "icmp.h"
 #include "ip.h"
 #include "net.h"
+#include "net_stats.h"
 #include "tcp.h"
 #include "udp.h"
 
@@ -73,6 +74,7 @@ static uint8_t ip_broadcast[4];
 
 static bool ip_is_directly_connected(const uint8_t* ip_remote);
 static bool ip_is_broadcast(const uint8_t* ip_remote);
+static bool ip_is_multicast(const uint8_t* ip_remote);
 
 /**
  * Initializes the IP layer and optionally assigns IP address, netmask and gateway.
@@ -99,9 +101,14 @@ void ip_init(const uint8_t* ip, const uint8_t* netmask, const uint8_t* gateway)
  */
 bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len)
 {
+    net_stats_inc(NET_STAT_IP_RX);
+
     /* check protocol version */
     if((packet->vlh.version >> 4) != 0x04)
+    {
+        net_stats_inc(NET_STAT_IP_RX_ERRORS);
         return false;
+    }
 
     /* get header length */
     uint8_t header_length = (packet->vlh.length_header & 0x0f) * 4;
@@ -112,15 +119,19 @@ bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len)
     if(NTOH16(packet->ffo.flags) & (IP_FLAGS_MORE_FRAGMENTS << 13) || /* flags */
        NTOH16(packet->ffo.fragment_offset) & 0x1fff                   /* fragment offset */
       )
+    {
+        net_stats_inc(NET_STAT_IP_RX_FRAGMENTS);
         return false;
+    }
 
-    /* check checksum */
-    if(ntoh16(packet->checksum) != ~net_calc_checksum(0, (uint8_t*) packet, header_length, 10))
-        return false;
-
-    /* check packet size */
-    if(packet_length > packet_len)
+    /* check checksum and packet size */
+    if(ntoh16(packet->checksum) != (uint16_t) ~net_calc_checksum(0, (uint8_t*) packet, header_length, 10) ||
+       packet_length > packet_len
+      )
+    {
+        net_stats_inc(NET_STAT_IP_RX_ERRORS);
         return false;
+    }
 
     /* check destination address */
     if(memcmp(packet->destination, ip_address, sizeof(packet->destination)) != 0)
@@ -131,7 +142,17 @@ bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len)
            packet->destination[2] != 0xff ||
            packet->destination[3] != 0xff 
           )
-            return false;
+        {
+            /* accept UDP to multicast groups joined by a socket */
+            if(!ip_is_multicast(packet->destination) ||
+               packet->protocol != IP_PROTOCOL_UDP ||
+               !udp_group_joined(packet->destination)
+              )
+            {
+                net_stats_inc(NET_STAT_IP_RX_NOT_FOR_US);
+                return false;
+            }
+        }
     }
 
     /* hand packet over to higher-level protocols */
@@ -142,8 +163,9 @@ bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len)
         case IP_PROTOCOL_TCP:
             return tcp_handle_packet(packet->source, (const struct tcp_header*) ((const uint8_t*) packet + header_length), packet_length - header_length);
         case IP_PROTOCOL_UDP:
-            return udp_handle_packet(packet->source, (const struct udp_header*) ((const uint8_t*) packet + header_length), packet_length - header_length);
+            return udp_handle_packet(packet->source, packet->destination, (const struct udp_header*) ((const uint8_t*) packet + header_length), packet_length - header_length);
         default:
+            net_stats_inc(NET_STAT_IP_RX_UNKNOWN);
             return false;
     }
 }
@@ -157,13 +179,39 @@ bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len)
  * \returns \c true on success, \c false on failure.
  */
 bool ip_send_packet(const uint8_t* ip_dest, uint8_t protocol, uint16_t data_len)
+{
+    return ip_send_packet_data(ip_dest, protocol, data_len, 0, 0);
+}
+
+/**
+ * Sends a packet whose payload starts in the transmit buffer and continues in a separate buffer.
+ *
+ * \param[in] ip_dest The IP address of the remote host to which the packet gets sent.
+ * \param[in] protocol The protocol identifier of the upper layer protocol.
+ * \param[in] header_len The length of the leading payload part which is read from the transmit buffer.
+ * \param[in] data A pointer to the trailing payload part, which is not copied into the transmit buffer.
+ * \param[in] data_len The length of the trailing payload part.
+ * \returns \c true on success, \c false on failure.
+ */
+bool ip_send_packet_data(const uint8_t* ip_dest, uint8_t protocol, uint16_t header_len, const uint8_t* data, uint16_t data_len)
 {
     uint8_t mac_dest[6];
+    const uint8_t* arp_target = 0;
     /* check if destination ip is a broadcast */
     if(ip_is_broadcast(ip_dest))
     {
         memset(mac_dest, 255, sizeof(mac_dest));
     }
+    else if(ip_is_multicast(ip_dest))
+    {
+        /* map the lower 23 bits of the group address */
+        mac_dest[0] = 0x01;
+        mac_dest[1] = 0x00;
+        mac_dest[2] = 0x5e;
+        mac_dest[3] = ip_dest[1] & 0x7f;
+        mac_dest[4] = ip_dest[2];
+        mac_dest[5] = ip_dest[3];
+    }
     else
     {
         /* check if destination ip is in our subnet */
@@ -176,22 +224,19 @@ bool ip_send_packet(const uint8_t* ip_dest, uint8_t protocol, uint16_t data_len)
         {
             /* check if a valid gateway is configured */
             if((ip_gateway[0] | ip_gateway[1] | ip_gateway[2] | ip_gateway[3]) != 0)
+            {
                 ip_mac_target = ip_gateway;
+            }
             else
+            {
+                net_stats_inc(NET_STAT_IP_TX_NO_ROUTE);
                 return false;
+            }
         }
 
         /* get mac address of destination via ARP */
         if(!arp_get_mac(ip_mac_target, mac_dest))
-            /* The ARP layer currently does not have the
-             * destination MAC address available, but an
-             * ARP request has been sent now. We can not
-             * deliver this packet until we get the ARP
-             * response. We will return success, although
-             * we lose the packet. The loss will have to
-             * be handled by higher-level protocols.
-             */
-            return true;
+            arp_target = ip_mac_target;
     }
     
     struct ip_header* header = (struct ip_header*) ethernet_get_buffer();
@@ -204,7 +249,7 @@ bool ip_send_packet(const uint8_t* ip_dest, uint8_t protocol, uint16_t data_len)
     header->vlh.length_header |= (NET_HEADER_SIZE_IP / 4) & 0x0f;
 
     /* packet size */
-    header->length_packet = hton16(NET_HEADER_SIZE_IP + data_len);
+    header->length_packet = hton16(NET_HEADER_SIZE_IP + header_len + data_len);
     
     /* time to live */
     header->ttl = 64;
@@ -221,11 +266,55 @@ bool ip_send_packet(const uint8_t* ip_dest, uint8_t protocol, uint16_t data_len)
     /* checksum */
     header->checksum = hton16(~net_calc_checksum(0, (uint8_t*) header, NET_HEADER_SIZE_IP, 10));
 
+    net_stats_inc(NET_STAT_IP_TX);
+
+    if(arp_target)
+    {
+        net_stats_inc(NET_STAT_ARP_MISSES);
+
+        /* The ARP layer currently does not have the
+         * destination MAC address available. The packet
+         * waits for the ARP response if there is room
+         * for it. We return success in any case, a lost
+         * packet will have to be handled by higher-level
+         * protocols.
+         */
+        bool queued = false;
+        if(header_len + data_len <= ip_get_buffer_size())
+        {
+            /* the waiting packet is kept as a whole */
+            memcpy(ip_get_buffer() + header_len, data, data_len);
+            queued = arp_queue_packet(arp_target, ETHERNET_FRAME_TYPE_IP, NET_HEADER_SIZE_IP + header_len + data_len);
+        }
+        if(!queued)
+            net_stats_inc(NET_STAT_ARP_QUEUE_DROPS);
+        return true;
+    }
+
     /* send packet */
-    return ethernet_send_packet(mac_dest,
-                                ETHERNET_FRAME_TYPE_IP,
-                                NET_HEADER_SIZE_IP + data_len
-                               );
+    return ethernet_send_packet_data(mac_dest,
+                                     ETHERNET_FRAME_TYPE_IP,
+                                     NET_HEADER_SIZE_IP + header_len,
+                                     data,
+                                     data_len
+                                    );
+}
+
+/**
+ * Calculates the checksum of the pseudo header preceding TCP and UDP packets.
+ *
+ * \param[in] ip_remote The remote IP address to which the packet gets sent or from which it was received.
+ * \param[in] protocol The protocol of the packet.
+ * \param[in] len The length of the TCP or UDP packet in bytes.
+ * \returns The checksum of the pseudo header, not inverted.
+ */
+uint16_t ip_calc_pseudo_checksum(const uint8_t* ip_remote, uint8_t protocol, uint16_t len)
+{
+    uint16_t checksum = protocol + len;
+    checksum = net_calc_checksum(checksum, ip_address, 4, 4);
+    checksum = net_calc_checksum(checksum, ip_remote, 4, 4);
+
+    return checksum;
 }
 
 /**
@@ -347,6 +436,16 @@ bool ip_is_broadcast(const uint8_t* ip_remote)
            memcmp(ip_remote, ip_get_broadcast(), 4) == 0;
 }
 
+/**
+ * Determines wether an IP address is a multicast group address or not.
+ *
+ * \returns \c true if the given address is within 224.0.0.0/4, \c false otherwise.
+ */
+bool ip_is_multicast(const uint8_t* ip_remote)
+{
+    return (ip_remote[0] & 0xf0) == 0xe0;
+}
+
 /**
  * @}
  * @}
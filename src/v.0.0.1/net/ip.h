@@ -52,8 +52,11 @@ void ip_init(const uint8_t* ip, const uint8_t* netmask, const uint8_t* gateway);
 bool ip_handle_packet(const struct ip_header* packet, uint16_t packet_len);
 
 bool ip_send_packet(const uint8_t* ip_dest, uint8_t protocol, uint16_t data_len);
+bool ip_send_packet_data(const uint8_t* ip_dest, uint8_t protocol, uint16_t header_len, const uint8_t* data, uint16_t data_len);
 
 const uint8_t* ip_get_address();
+
+uint16_t ip_calc_pseudo_checksum(const uint8_t* ip_remote, uint8_t protocol, uint16_t len);
 void ip_set_address(const uint8_t* ip_local);
 
 const uint8_t* ip_get_netmask();
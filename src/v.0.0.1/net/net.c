@@ -112,6 +112,25 @@ uint16_t net_calc_checksum(uint16_t checksum, const uint8_t* data, uint16_t data
     return checksum;
 }
 
+/**
+ * Compares a received Internet checksum with a calculated one.
+ *
+ * One's complement arithmetic has two representations of zero, and senders
+ * differ in which one they put on the wire. Both are accepted here.
+ *
+ * \param[in] received The checksum field of the received packet.
+ * \param[in] calculated The checksum calculated over the received packet.
+ * \returns \c 1 if the checksums match, \c 0 otherwise.
+ */
+uint8_t net_checksum_equal(uint16_t received, uint16_t calculated)
+{
+    if(received == calculated)
+        return 1;
+
+    return (received == 0x0000 || received == 0xffff) &&
+           (calculated == 0x0000 || calculated == 0xffff);
+}
+
 /**
  * Converts a 16-bit integer to network byte order.
  *
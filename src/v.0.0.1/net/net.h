@@ -63,9 +63,9 @@
 #define HTON16(val) (val)
 #define HTON32(val) (val)
 #else
-#define HTON16(val) ((((uint16_t) (val)) << 8) | \
-                     (((uint16_t) (val)) >> 8)   \
-                    )
+#define HTON16(val) ((uint16_t) ((((uint16_t) (val)) << 8) | \
+                                  (((uint16_t) (val)) >> 8)   \
+                                 ))
 #define HTON32(val) (((((uint32_t) (val)) & 0x000000ff) << 24) | \
                      ((((uint32_t) (val)) & 0x0000ff00) <<  8) | \
                      ((((uint32_t) (val)) & 0x00ff0000) >>  8) | \
@@ -110,6 +110,7 @@
 /* checksum calculation */
 
 uint16_t net_calc_checksum(uint16_t checksum, const uint8_t* data, uint16_t data_len, uint8_t skip);
+uint8_t net_checksum_equal(uint16_t received, uint16_t calculated);
 uint16_t hton16(uint16_t h);
 uint32_t hton32(uint32_t h);
 
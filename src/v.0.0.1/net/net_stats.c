@@ -0,0 +1,165 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <string.h>
+
+#include "hal.h"
+#include "net_stats.h"
+
+/**
+ * \addtogroup net
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_stack
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_stack_stats Network statistics
+ *
+ * Counters of the events on all layers of the network stack.
+ *
+ * @{
+ */
+/**
+ * \file
+ * Network statistics implementation
+ */
+
+/* the counters, incremented in place by the protocol layers */
+uint16_t net_stats[NET_STAT_COUNT];
+
+static const char net_stats_name_eth_rx[] PROGMEM = "eth_rx";
+static const char net_stats_name_eth_rx_unknown[] PROGMEM = "eth_rx_unknown";
+static const char net_stats_name_eth_tx[] PROGMEM = "eth_tx";
+static const char net_stats_name_eth_tx_errors[] PROGMEM = "eth_tx_errors";
+static const char net_stats_name_hal_rx_overflows[] PROGMEM = "hal_rx_overflows";
+static const char net_stats_name_hal_tx_errors[] PROGMEM = "hal_tx_errors";
+static const char net_stats_name_arp_rx[] PROGMEM = "arp_rx";
+static const char net_stats_name_arp_misses[] PROGMEM = "arp_misses";
+static const char net_stats_name_arp_queue_drops[] PROGMEM = "arp_queue_drops";
+static const char net_stats_name_ip_rx[] PROGMEM = "ip_rx";
+static const char net_stats_name_ip_rx_errors[] PROGMEM = "ip_rx_errors";
+static const char net_stats_name_ip_rx_fragments[] PROGMEM = "ip_rx_fragments";
+static const char net_stats_name_ip_rx_not_for_us[] PROGMEM = "ip_rx_not_for_us";
+static const char net_stats_name_ip_rx_unknown[] PROGMEM = "ip_rx_unknown";
+static const char net_stats_name_ip_tx[] PROGMEM = "ip_tx";
+static const char net_stats_name_ip_tx_no_route[] PROGMEM = "ip_tx_no_route";
+static const char net_stats_name_tcp_rx[] PROGMEM = "tcp_rx";
+static const char net_stats_name_tcp_rx_checksum[] PROGMEM = "tcp_rx_checksum";
+static const char net_stats_name_tcp_rx_out_of_window[] PROGMEM = "tcp_rx_out_of_window";
+static const char net_stats_name_tcp_rx_resets[] PROGMEM = "tcp_rx_resets";
+static const char net_stats_name_tcp_tx_resets[] PROGMEM = "tcp_tx_resets";
+static const char net_stats_name_tcp_retransmits[] PROGMEM = "tcp_retransmits";
+static const char net_stats_name_tcp_fast_retransmits[] PROGMEM = "tcp_fast_retransmits";
+static const char net_stats_name_tcp_refused_no_slot[] PROGMEM = "tcp_refused_no_slot";
+static const char net_stats_name_tcp_refused_by_app[] PROGMEM = "tcp_refused_by_app";
+static const char net_stats_name_tcp_refused_no_listener[] PROGMEM = "tcp_refused_no_listener";
+static const char net_stats_name_tcp_evicted[] PROGMEM = "tcp_evicted";
+static const char net_stats_name_tcp_keepalive_timeouts[] PROGMEM = "tcp_keepalive_timeouts";
+static const char net_stats_name_udp_rx[] PROGMEM = "udp_rx";
+static const char net_stats_name_udp_rx_checksum[] PROGMEM = "udp_rx_checksum";
+static const char net_stats_name_udp_rx_no_socket[] PROGMEM = "udp_rx_no_socket";
+static const char net_stats_name_udp_tx[] PROGMEM = "udp_tx";
+
+/* in the order of enum net_stat */
+static PGM_P const net_stats_names[NET_STAT_COUNT] PROGMEM =
+{
+    net_stats_name_eth_rx,
+    net_stats_name_eth_rx_unknown,
+    net_stats_name_eth_tx,
+    net_stats_name_eth_tx_errors,
+    net_stats_name_hal_rx_overflows,
+    net_stats_name_hal_tx_errors,
+    net_stats_name_arp_rx,
+    net_stats_name_arp_misses,
+    net_stats_name_arp_queue_drops,
+    net_stats_name_ip_rx,
+    net_stats_name_ip_rx_errors,
+    net_stats_name_ip_rx_fragments,
+    net_stats_name_ip_rx_not_for_us,
+    net_stats_name_ip_rx_unknown,
+    net_stats_name_ip_tx,
+    net_stats_name_ip_tx_no_route,
+    net_stats_name_tcp_rx,
+    net_stats_name_tcp_rx_checksum,
+    net_stats_name_tcp_rx_out_of_window,
+    net_stats_name_tcp_rx_resets,
+    net_stats_name_tcp_tx_resets,
+    net_stats_name_tcp_retransmits,
+    net_stats_name_tcp_fast_retransmits,
+    net_stats_name_tcp_refused_no_slot,
+    net_stats_name_tcp_refused_by_app,
+    net_stats_name_tcp_refused_no_listener,
+    net_stats_name_tcp_evicted,
+    net_stats_name_tcp_keepalive_timeouts,
+    net_stats_name_udp_rx,
+    net_stats_name_udp_rx_checksum,
+    net_stats_name_udp_rx_no_socket,
+    net_stats_name_udp_tx
+};
+
+static void net_stats_tx_done(char ok);
+
+/**
+ * Clears all network counters.
+ */
+void net_stats_init()
+{
+    memset(net_stats, 0, sizeof(net_stats));
+
+    hal_set_tx_callback(net_stats_tx_done);
+}
+
+/**
+ * Counts the packets the network hardware failed to send.
+ *
+ * \param[in] ok Nonzero if the packet was sent, zero if it was aborted.
+ */
+void net_stats_tx_done(char ok)
+{
+    if(!ok)
+        net_stats_inc(NET_STAT_HAL_TX_ERRORS);
+}
+
+/**
+ * Retrieves the network counters.
+ *
+ * The receive overflow counter of the network hardware driver is fetched first.
+ *
+ * \returns A pointer to the #NET_STAT_COUNT counters, indexed by #net_stat.
+ */
+const uint16_t* net_stats_get()
+{
+    net_stats[NET_STAT_HAL_RX_OVERFLOWS] = hal_rx_overflows();
+
+    return net_stats;
+}
+
+/**
+ * Retrieves the name of a network counter.
+ *
+ * \param[in] stat The counter, one of #net_stat.
+ * \returns The name in program memory.
+ */
+PGM_P net_stats_get_name(uint8_t stat)
+{
+    if(stat >= NET_STAT_COUNT)
+        return 0;
+
+    return (PGM_P) pgm_read_word(&net_stats_names[stat]);
+}
+
+/**
+ * @}
+ * @}
+ * @}
+ */
+
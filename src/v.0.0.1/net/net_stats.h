@@ -0,0 +1,100 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef NET_STATS_H
+#define NET_STATS_H
+
+#include <stdint.h>
+
+#include <avr/pgmspace.h>
+
+/**
+ * \addtogroup net
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_stack
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_stack_stats
+ *
+ * @{
+ */
+/**
+ * \file
+ * Network statistics header
+ */
+
+/**
+ * Network event counters.
+ *
+ * Every counter is 16 bits wide and wraps around. The order is part of the
+ * Modbus input register map, so new counters are appended before
+ * #NET_STAT_COUNT only.
+ */
+enum net_stat
+{
+    NET_STAT_ETH_RX,                /**< Frames received. */
+    NET_STAT_ETH_RX_UNKNOWN,        /**< Frames of neither ARP nor IP type. */
+    NET_STAT_ETH_TX,                /**< Frames sent. */
+    NET_STAT_ETH_TX_ERRORS,         /**< Frames the hardware did not take. */
+    NET_STAT_HAL_RX_OVERFLOWS,      /**< Receive buffer overflows of the hardware. */
+    NET_STAT_HAL_TX_ERRORS,         /**< Frames aborted by the hardware. */
+    NET_STAT_ARP_RX,                /**< ARP packets accepted. */
+    NET_STAT_ARP_MISSES,            /**< Packets sent to a host of unknown hardware address. */
+    NET_STAT_ARP_QUEUE_DROPS,       /**< Of these, packets which could not wait for the ARP reply. */
+    NET_STAT_IP_RX,                 /**< IP packets received. */
+    NET_STAT_IP_RX_ERRORS,          /**< IP packets with a bad version, length or header checksum. */
+    NET_STAT_IP_RX_FRAGMENTS,       /**< IP fragments, which are not supported. */
+    NET_STAT_IP_RX_NOT_FOR_US,      /**< IP packets for other hosts or groups. */
+    NET_STAT_IP_RX_UNKNOWN,         /**< IP packets of an unsupported protocol. */
+    NET_STAT_IP_TX,                 /**< IP packets sent. */
+    NET_STAT_IP_TX_NO_ROUTE,        /**< IP packets to other subnets without a gateway. */
+    NET_STAT_TCP_RX,                /**< TCP segments received. */
+    NET_STAT_TCP_RX_CHECKSUM,       /**< TCP segments with a bad checksum. */
+    NET_STAT_TCP_RX_OUT_OF_WINDOW,  /**< TCP segments outside the receive window. */
+    NET_STAT_TCP_RX_RESETS,         /**< Connections reset by the remote host. */
+    NET_STAT_TCP_TX_RESETS,         /**< TCP resets sent. */
+    NET_STAT_TCP_RETRANSMITS,       /**< Retransmission timeouts. */
+    NET_STAT_TCP_FAST_RETRANSMITS,  /**< Retransmissions triggered by duplicate ACKs. */
+    NET_STAT_TCP_REFUSED_NO_SLOT,   /**< Connection requests dropped for lack of a slot or buffer space. */
+    NET_STAT_TCP_REFUSED_BY_APP,    /**< Connection requests the application did not accept. */
+    NET_STAT_TCP_REFUSED_NO_LISTENER, /**< Connection requests to ports nobody listens on. */
+    NET_STAT_TCP_EVICTED,           /**< Idle or TIME_WAIT connections closed to make room for a new one. */
+    NET_STAT_TCP_KEEPALIVE_TIMEOUTS, /**< Connections reset because keep-alive probes were not answered. */
+    NET_STAT_UDP_RX,                /**< UDP datagrams received. */
+    NET_STAT_UDP_RX_CHECKSUM,       /**< UDP datagrams with a bad checksum. */
+    NET_STAT_UDP_RX_NO_SOCKET,      /**< UDP datagrams to ports without a socket. */
+    NET_STAT_UDP_TX,                /**< UDP datagrams sent. */
+    NET_STAT_COUNT
+};
+
+extern uint16_t net_stats[NET_STAT_COUNT];
+
+/**
+ * Counts an event.
+ *
+ * \param[in] stat The counter of the event, one of #net_stat.
+ */
+#define net_stats_inc(stat) (++net_stats[(stat)])
+
+void net_stats_init();
+const uint16_t* net_stats_get();
+PGM_P net_stats_get_name(uint8_t stat);
+
+/**
+ * @}
+ * @}
+ * @}
+ */
+
+#endif
+
@@ -0,0 +1,339 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <linux/if.h>
+#include <linux/if_tun.h>
+
+#include "tap.h"
+
+/**
+ * \addtogroup net
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_tap Linux TAP and pcap replay driver
+ *
+ * Network driver for running the protocol stack as a Linux process.
+ *
+ * By default the driver attaches to a TAP interface, which has to be
+ * created beforehand (e.g. <tt>ip tuntap add tap0 mode tap</tt>). When
+ * #TAP_ENV_PCAP_IN is set, the packets of that pcap file are fed to the
+ * stack one by one instead, which gives deterministic runs. Sent packets
+ * are written to the pcap file named by #TAP_ENV_PCAP_OUT, if any.
+ * #TAP_ENV_DROP injects packet loss for testing the retransmission logic.
+ *
+ * The driver is selected in net/hal.h by defining \c HAL_TAP.
+ *
+ * @{
+ */
+/**
+ * \file
+ * Linux TAP and pcap replay driver implementation
+ */
+
+struct tap_pcap_header
+{
+    uint32_t magic;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+};
+
+struct tap_pcap_record
+{
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+};
+
+#define TAP_PCAP_MAGIC 0xa1b2c3d4
+#define TAP_PCAP_LINKTYPE_ETHERNET 1
+
+static int tap_fd = -1;
+static FILE* tap_pcap_in;
+static FILE* tap_pcap_out;
+static unsigned int tap_drop_every;
+static unsigned int tap_drop_rx;
+static unsigned int tap_drop_tx;
+
+static bool tap_open_device(const char* name);
+static bool tap_open_pcap_in(const char* path);
+static bool tap_open_pcap_out(const char* path);
+static bool tap_drop(unsigned int* count);
+
+/**
+ * Opens the TAP interface or the pcap replay file.
+ *
+ * \param[in] mac The hardware address of the stack, not used by this driver.
+ * \returns \c true on success, \c false on failure.
+ */
+bool tap_init(const uint8_t* mac)
+{
+	const char* pcap_in = getenv(TAP_ENV_PCAP_IN);
+	const char* pcap_out = getenv(TAP_ENV_PCAP_OUT);
+	const char* device = getenv(TAP_ENV_DEVICE);
+	const char* drop = getenv(TAP_ENV_DROP);
+
+	(void) mac;
+
+	if(drop) {
+		tap_drop_every = (unsigned int) atoi(drop);
+	}
+
+	if(pcap_out && !tap_open_pcap_out(pcap_out)) {
+		return false;
+	}
+
+	if(pcap_in) {
+		return tap_open_pcap_in(pcap_in);
+	}
+
+	return tap_open_device(device ? device : "tap0");
+}
+
+/**
+ * Fetches the next packet from the TAP interface or the replay file.
+ *
+ * \param[out] buffer The buffer which receives the packet.
+ * \param[in] buffer_len The length of the buffer.
+ * \returns The packet size on success, \c 0 if no packet is waiting or it did not fit.
+ */
+uint16_t tap_receive_packet(uint8_t* buffer, uint16_t buffer_len)
+{
+	if(tap_pcap_in) {
+		struct tap_pcap_record record;
+
+		if(fread(&record, sizeof(record), 1, tap_pcap_in) != 1) {
+			return 0;
+		}
+
+		if(record.incl_len > buffer_len) {
+			fseek(tap_pcap_in, record.incl_len, SEEK_CUR);
+			return 0;
+		}
+
+		if(fread(buffer, 1, record.incl_len, tap_pcap_in) != record.incl_len) {
+			return 0;
+		}
+
+		return tap_drop(&tap_drop_rx) ? 0 : record.incl_len;
+	}
+
+	if(tap_fd < 0) {
+		return 0;
+	}
+
+	ssize_t len = read(tap_fd, buffer, buffer_len);
+	if(len <= 0 || tap_drop(&tap_drop_rx)) {
+		return 0;
+	}
+
+	return len;
+}
+
+/**
+ * Sends a packet to the TAP interface and appends it to the output capture.
+ *
+ * \param[in] buffer The packet, ethernet header plus payload.
+ * \param[in] buffer_len The length of the packet.
+ * \returns \c true if the packet was sent, \c false otherwise.
+ */
+bool tap_send_packet(const uint8_t* buffer, uint16_t buffer_len)
+{
+	/* pretend the packet got lost on the wire */
+	if(tap_drop(&tap_drop_tx)) {
+		return true;
+	}
+
+	if(tap_pcap_out) {
+		struct tap_pcap_record record;
+		struct timeval now;
+
+		gettimeofday(&now, 0);
+		record.ts_sec = now.tv_sec;
+		record.ts_usec = now.tv_usec;
+		record.incl_len = buffer_len;
+		record.orig_len = buffer_len;
+
+		fwrite(&record, sizeof(record), 1, tap_pcap_out);
+		fwrite(buffer, 1, buffer_len, tap_pcap_out);
+		fflush(tap_pcap_out);
+	}
+
+	if(tap_pcap_in) {
+		return true;
+	}
+
+	if(tap_fd < 0) {
+		return false;
+	}
+
+	return write(tap_fd, buffer, buffer_len) == buffer_len;
+}
+
+/**
+ * Sends a packet made up of two buffers to the TAP interface.
+ *
+ * \param[in] buffer The ethernet header and the leading part of the payload.
+ * \param[in] buffer_len The length of the leading part.
+ * \param[in] data The trailing part of the payload.
+ * \param[in] data_len The length of the trailing part.
+ * \returns \c true if the packet was sent, \c false otherwise.
+ */
+bool tap_send_packet_data(const uint8_t* buffer, uint16_t buffer_len, const uint8_t* data, uint16_t data_len)
+{
+	static uint8_t packet[1518];
+
+	if((uint32_t) buffer_len + data_len > sizeof(packet)) {
+		return false;
+	}
+
+	memcpy(packet, buffer, buffer_len);
+	memcpy(packet + buffer_len, data, data_len);
+
+	return tap_send_packet(packet, buffer_len + data_len);
+}
+
+/**
+ * Checks wether the link is up.
+ *
+ * A replay is considered linked until its last packet was read.
+ *
+ * \returns \c true if the interface or replay file is open, \c false otherwise.
+ */
+bool tap_link_up()
+{
+	if(tap_pcap_in) {
+		return !feof(tap_pcap_in);
+	}
+
+	return tap_fd >= 0;
+}
+
+/**
+ * Attaches to an existing TAP interface in non-blocking mode.
+ *
+ * \param[in] name The name of the interface.
+ * \returns \c true on success, \c false on failure.
+ */
+bool tap_open_device(const char* name)
+{
+	struct ifreq ifr;
+
+	tap_fd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+	if(tap_fd < 0) {
+		perror("[tap] /dev/net/tun");
+		return false;
+	}
+
+	memset(&ifr, 0, sizeof(ifr));
+	ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+	strncpy(ifr.ifr_name, name, IFNAMSIZ - 1);
+
+	if(ioctl(tap_fd, TUNSETIFF, &ifr) < 0) {
+		perror("[tap] TUNSETIFF");
+		close(tap_fd);
+		tap_fd = -1;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Opens a pcap file for replay and checks its header.
+ *
+ * \param[in] path The path of the capture.
+ * \returns \c true on success, \c false on failure.
+ */
+bool tap_open_pcap_in(const char* path)
+{
+	struct tap_pcap_header header;
+
+	tap_pcap_in = fopen(path, "rb");
+	if(!tap_pcap_in) {
+		perror("[tap] pcap in");
+		return false;
+	}
+
+	if(fread(&header, sizeof(header), 1, tap_pcap_in) != 1 ||
+	   header.magic != TAP_PCAP_MAGIC ||
+	   header.network != TAP_PCAP_LINKTYPE_ETHERNET
+	) {
+		fprintf(stderr, "[tap] %s: not an ethernet pcap file\n", path);
+		fclose(tap_pcap_in);
+		tap_pcap_in = 0;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Creates the pcap file which receives the sent packets.
+ *
+ * \param[in] path The path of the capture.
+ * \returns \c true on success, \c false on failure.
+ */
+bool tap_open_pcap_out(const char* path)
+{
+	struct tap_pcap_header header;
+
+	tap_pcap_out = fopen(path, "wb");
+	if(!tap_pcap_out) {
+		perror("[tap] pcap out");
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = TAP_PCAP_MAGIC;
+	header.version_major = 2;
+	header.version_minor = 4;
+	header.snaplen = 0xffff;
+	header.network = TAP_PCAP_LINKTYPE_ETHERNET;
+
+	fwrite(&header, sizeof(header), 1, tap_pcap_out);
+
+	return true;
+}
+
+/**
+ * Decides whether to drop a packet for loss injection.
+ *
+ * \param[in,out] count The packet counter of the direction.
+ * \returns \c true if the packet is to be dropped, \c false otherwise.
+ */
+bool tap_drop(unsigned int* count)
+{
+	if(tap_drop_every < 1 || ++*count < tap_drop_every) {
+		return false;
+	}
+
+	*count = 0;
+	return true;
+}
+
+/**
+ * @}
+ * @}
+ */
+
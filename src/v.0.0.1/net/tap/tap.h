@@ -0,0 +1,63 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef TAP_H
+#define TAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * \addtogroup net
+ *
+ * @{
+ */
+/**
+ * \addtogroup net_tap
+ *
+ * @{
+ */
+/**
+ * \file
+ * Linux TAP and pcap replay driver header
+ */
+
+/**
+ * The environment variable naming the TAP interface, \c tap0 if unset.
+ */
+#define TAP_ENV_DEVICE "NET_TAP_DEVICE"
+
+/**
+ * The environment variable naming a pcap file to replay instead of using a TAP interface.
+ */
+#define TAP_ENV_PCAP_IN "NET_TAP_PCAP_IN"
+
+/**
+ * The environment variable naming a pcap file which receives the sent packets.
+ */
+#define TAP_ENV_PCAP_OUT "NET_TAP_PCAP_OUT"
+
+/**
+ * The environment variable for packet loss injection: when set to \c N,
+ * every N-th packet in each direction is silently dropped.
+ */
+#define TAP_ENV_DROP "NET_TAP_DROP"
+
+bool tap_init(const uint8_t* mac);
+uint16_t tap_receive_packet(uint8_t* buffer, uint16_t buffer_len);
+bool tap_send_packet(const uint8_t* buffer, uint16_t buffer_len);
+bool tap_send_packet_data(const uint8_t* buffer, uint16_t buffer_len, const uint8_t* data, uint16_t data_len);
+bool tap_link_up();
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
+
@@ -7,11 +7,14 @@
  * published by the Free Software Foundation.
  */
 
+#include "hal.h"
 #include "ip.h"
 #include "net.h"
+#include "net_stats.h"
 #include "tcp.h"
 #include "tcp_queue.h"
 
+#include "../arch/timebase.h"
 #include "../sys/timer.h"
 
 #include <stdlib.h>
@@ -57,6 +60,11 @@
  * Events are generated whenever data was successfully sent or received. Use
  * tcp_buffer_used_rx() to check how much data is waiting to be read from a socket.
  *
+ * When a segment arrives while the receive buffer is empty, tcp_read(),
+ * tcp_peek() and tcp_skip() called from the TCP_EVT_DATA_RECEIVED event
+ * work on the received packet directly. Only the data left unread is
+ * copied to the receive buffer afterwards.
+ *
  * @{
  */
 /**
@@ -112,9 +120,21 @@ struct tcp_tcb
 	uint16_t window;
 	uint8_t timeout;
 	uint8_t retx;
-	uint8_t rto;
-	uint8_t sa;
-	uint8_t sv;
+	uint8_t dupacks;
+	uint8_t keepalive_probes;
+	uint32_t last_activity;
+	uint16_t rto;
+	uint16_t srtt;
+	uint16_t rttvar;
+	uint32_t rtt_seq;
+	uint32_t rtt_start;
+	uint32_t rtx_time;
+	bool rtt_active;
+	bool rtx_armed;
+	bool output;
+	uint8_t reserved;
+	const uint8_t* rx_direct;
+	uint16_t rx_direct_len;
 	struct tcp_queue* queue;
 };
 
@@ -132,11 +152,26 @@ struct tcp_header
 };
 
 static struct tcp_tcb tcp_tcbs[TCP_MAX_SOCKET_COUNT];
+static int tcp_output_timer = -1;
+static int tcp_rtx_timer = -1;
+static struct tcp_rx_stats tcp_rx_stats;
 
 #define FOREACH_TCB(tcb) \
 	for((tcb) = &tcp_tcbs[0]; (tcb) < &tcp_tcbs[TCP_MAX_SOCKET_COUNT]; ++(tcb))
 
 static void tcp_interval(int timer);
+static void tcp_output(int timer);
+static void tcp_output_schedule(struct tcp_tcb* tcb);
+static void tcp_send_fin(struct tcp_tcb* tcb);
+static void tcp_rtx_interval(int timer);
+static void tcp_rtx_arm(struct tcp_tcb* tcb);
+static void tcp_retransmit(struct tcp_tcb* tcb);
+static void tcp_rtt_sample(struct tcp_tcb* tcb, uint16_t m);
+static void tcp_rx_direct_flush(struct tcp_tcb* tcb);
+static uint16_t tcp_window(const struct tcp_tcb* tcb);
+static bool tcp_keepalive(struct tcp_tcb* tcb);
+static bool tcp_evict_idle(const struct tcp_tcb* listener);
+static bool tcp_tcb_guaranteed(const struct tcp_tcb* tcb);
 
 static void tcp_process_timeout(struct tcp_tcb* tcb);
 static bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uint16_t packet_len, const uint8_t* ip);
@@ -151,10 +186,13 @@ static int tcp_tcb_socket(const struct tcp_tcb* tcb);
 
 static bool tcp_port_is_used(uint16_t port);
 static uint16_t tcp_port_find_unused();
+static uint8_t tcp_queue_reservations(const struct tcp_tcb* listener);
 static uint16_t tcp_calc_checksum(const uint8_t* ip_destination, const struct tcp_header* packet, uint16_t packet_len);
 
 static bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data);
+static bool tcp_send_segments(struct tcp_tcb* tcb, uint8_t flags, bool send_data, uint8_t max_segments);
 static bool tcp_send_rst(const uint8_t* ip_destination, const struct tcp_header* packet, uint16_t packet_len);
+static bool tcp_send_empty(struct tcp_tcb* tcb, uint8_t flags, uint32_t seq);
 
 /**
  * Initializes the TCP layer.
@@ -165,6 +203,9 @@ void tcp_init()
 
 	int timer = timer_alloc(tcp_interval, 0);
 	timer_set(timer, 1000);
+
+	tcp_output_timer = timer_alloc(tcp_output, 0);
+	tcp_rtx_timer = timer_alloc(tcp_rtx_interval, 0);
 }
 
 /**
@@ -182,10 +223,15 @@ bool tcp_handle_packet(const uint8_t* ip, const struct tcp_header* packet, uint1
 	if(packet_len < sizeof(*packet))
 		return false;
 
-	/* test checksum */
-	if(tcp_calc_checksum(ip, packet, packet_len) != ntoh16(packet->checksum))
+	/* test checksum, unless the network hardware already did */
+	if(!hal_checksum_verified() && !net_checksum_equal(ntoh16(packet->checksum), tcp_calc_checksum(ip, packet, packet_len)))
+	{
 		/* invalid checksum */
+		net_stats_inc(NET_STAT_TCP_RX_CHECKSUM);
 		return false;
+	}
+
+	net_stats_inc(NET_STAT_TCP_RX);
 
 	FOREACH_TCB(tcb) {
 		if(tcb->state == TCP_STATE_UNUSED)
@@ -207,10 +253,18 @@ bool tcp_handle_packet(const uint8_t* ip, const struct tcp_header* packet, uint1
 	}
 
 	if(tcb_selected) {
+		/* the remote host is alive */
+		if(tcb_selected->state != TCP_STATE_LISTEN) {
+			tcb_selected->last_activity = timer_millis();
+			tcb_selected->keepalive_probes = 0;
+		}
+
 		return tcp_state_machine(tcb_selected, packet, packet_len, ip);
 	}
 
 	/* no tcb found, generate RST */
+	if((packet->flags & (TCP_FLAG_SYN | TCP_FLAG_ACK)) == TCP_FLAG_SYN)
+		net_stats_inc(NET_STAT_TCP_REFUSED_NO_LISTENER);
 	tcp_send_rst(ip, packet, packet_len);
 
 	return false;
@@ -237,6 +291,377 @@ void tcp_interval(int timer)
 	timer_set(timer, 1000);
 }
 
+/**
+ * Transmits the data written to the sockets since the last call.
+ *
+ * Writes are collected and sent on the next timer tick, so a response
+ * composed of several writes leaves in as few segments as possible and
+ * does not wait for the one second retransmission timer. A connection
+ * being closed by us gets its FIN here as soon as all data is acknowledged.
+ *
+ * \param[in] timer Timer identifier which generated the timeout event.
+ */
+void tcp_output(int timer)
+{
+	struct tcp_tcb* tcb;
+
+	FOREACH_TCB(tcb) {
+		if(!tcb->output)
+			continue;
+
+		tcb->output = false;
+
+		if(tcb->state != TCP_STATE_ESTABLISHED &&
+		   tcb->state != TCP_STATE_START_CLOSE &&
+		   tcb->state != TCP_STATE_CLOSE_WAIT
+		  )
+			continue;
+
+		if(tcb->state == TCP_STATE_START_CLOSE && tcp_queue_used_tx(tcb->queue) < 1)
+		{
+			tcp_send_fin(tcb);
+			continue;
+		}
+
+		if(tcb->send_next >= tcp_queue_used_tx(tcb->queue))
+			continue;
+
+		if(!tcp_send_packet(tcb, TCP_FLAG_ACK, true))
+		{
+			tcb->state = TCP_STATE_CLOSED;
+			tcb->timeout = 0;
+			tcb->callback(tcp_tcb_socket(tcb), TCP_EVT_ERROR);
+		}
+	}
+}
+
+/**
+ * Marks a connection for transmission on the next timer tick.
+ *
+ * \param[in] tcb The transfer control block with new data queued or to be closed.
+ */
+void tcp_output_schedule(struct tcp_tcb* tcb)
+{
+	if(tcb->output)
+		return;
+
+	tcb->output = true;
+	timer_set(tcp_output_timer, 0);
+}
+
+/**
+ * Actively closes a connection whose outgoing data has all been acknowledged.
+ *
+ * \param[in] tcb The transfer control block in state TCP_STATE_START_CLOSE.
+ */
+void tcp_send_fin(struct tcp_tcb* tcb)
+{
+	tcp_send_packet(tcb, TCP_FLAG_ACK | TCP_FLAG_FIN, true);
+
+	tcb->state = TCP_STATE_FIN_WAIT_1;
+	tcb->timeout = TCP_TIMEOUT_GENERIC;
+	tcb->retx = 0;
+}
+
+/**
+ * Checks the retransmission timers of all connections.
+ *
+ * Runs every timer tick while any retransmission timer is armed.
+ *
+ * \param[in] timer Timer identifier which generated the timeout event.
+ */
+void tcp_rtx_interval(int timer)
+{
+	struct tcp_tcb* tcb;
+	uint32_t now = timer_millis();
+	bool armed = false;
+
+	FOREACH_TCB(tcb) {
+		if(!tcb->rtx_armed)
+			continue;
+
+		if((tcb->state != TCP_STATE_ESTABLISHED &&
+		    tcb->state != TCP_STATE_START_CLOSE &&
+		    tcb->state != TCP_STATE_CLOSE_WAIT
+		   ) ||
+		   tcp_queue_used_tx(tcb->queue) < 1
+		  )
+		{
+			tcb->rtx_armed = false;
+			continue;
+		}
+
+		if((int32_t) (now - tcb->rtx_time) >= 0)
+		{
+			tcb->rtx_armed = false;
+			tcp_retransmit(tcb);
+		}
+
+		if(tcb->rtx_armed)
+			armed = true;
+	}
+
+	if(armed)
+		timer_set(timer, TIMER_MS_PER_TICK);
+}
+
+/**
+ * (Re)starts the retransmission timer of a connection.
+ *
+ * The timeout is the current RTO, doubled for each retransmission of
+ * the same data and bounded by #TCP_RTO_MAX.
+ *
+ * \param[in] tcb The transfer control block with data in flight.
+ */
+void tcp_rtx_arm(struct tcp_tcb* tcb)
+{
+	uint32_t rto = (uint32_t) tcb->rto << (tcb->retx > 4 ? 4 : tcb->retx); /* exponential backoff */
+	if(rto > TCP_RTO_MAX)
+		rto = TCP_RTO_MAX;
+
+	tcb->rtx_time = timer_millis() + rto;
+	tcb->rtx_armed = true;
+
+	if(timer_expired(tcp_rtx_timer))
+		timer_set(tcp_rtx_timer, TIMER_MS_PER_TICK);
+}
+
+/**
+ * Resends the oldest unacknowledged segment of a connection.
+ *
+ * The rest follows as the remote host acknowledges it.
+ *
+ * \param[in] tcb The transfer control block whose data to resend.
+ */
+void tcp_retransmit(struct tcp_tcb* tcb)
+{
+	if(++tcb->retx > TCP_MAX_RETRY)
+	{
+		tcb->state = TCP_STATE_CLOSED;
+		tcb->timeout = 0;
+		tcb->callback(tcp_tcb_socket(tcb), TCP_EVT_TIMEOUT);
+		return;
+	}
+
+	net_stats_inc(NET_STAT_TCP_RETRANSMITS);
+
+	/* Karn's algorithm: never sample the round trip of retransmitted data */
+	tcb->rtt_active = false;
+	tcb->dupacks = 0;
+
+	tcb->send_next = 0;
+	tcp_send_segments(tcb, TCP_FLAG_ACK, true, 1);
+}
+
+/**
+ * Updates the round trip time estimation and the retransmission timeout.
+ *
+ * Taken out of
+ * "Congestion Avoidance and Control"
+ * by Van Jacobson in
+ * "Proceedings of SIGCOMM '88"
+ * Stanford, 1988, ACM.
+ *
+ * \param[in] tcb The transfer control block of the connection.
+ * \param[in] m The measured round trip time in milliseconds.
+ */
+void tcp_rtt_sample(struct tcp_tcb* tcb, uint16_t m)
+{
+	/* keep the scaled values within 16 bits */
+	if(m > 0x0fff)
+		m = 0x0fff;
+
+	if(!tcb->srtt)
+	{
+		/* first sample */
+		tcb->srtt = (m << 3) | 1;
+		tcb->rttvar = m << 1;
+	}
+	else
+	{
+		int16_t err = m - (tcb->srtt >> 3);
+		tcb->srtt += err;
+		if(err < 0)
+			err = -err;
+		err -= tcb->rttvar >> 2;
+		tcb->rttvar += err;
+	}
+
+	uint32_t rto = (tcb->srtt >> 3) + tcb->rttvar;
+	if(rto < TCP_RTO_MIN)
+		rto = TCP_RTO_MIN;
+	if(rto > TCP_RTO_MAX)
+		rto = TCP_RTO_MAX;
+
+	tcb->rto = rto;
+}
+
+/**
+ * Copies the unread data of a received packet to the receive buffer.
+ *
+ * Ends reading straight from the packet. Does nothing if the data
+ * already is in the receive buffer.
+ *
+ * \param[in] tcb The transfer control block of the connection.
+ */
+void tcp_rx_direct_flush(struct tcp_tcb* tcb)
+{
+	if(!tcb->rx_direct)
+		return;
+
+	tcp_rx_stats.bytes_queued += tcp_queue_put_rx(tcb->queue, tcb->rx_direct, tcb->rx_direct_len);
+
+	tcb->rx_direct = 0;
+	tcb->rx_direct_len = 0;
+}
+
+/**
+ * Calculates the receive window to advertise.
+ *
+ * Data the application reads straight from the packet is queued
+ * afterwards, so it already occupies its part of the receive buffer.
+ *
+ * \param[in] tcb The transfer control block of the connection.
+ * \returns The number of bytes the peer may send.
+ */
+uint16_t tcp_window(const struct tcp_tcb* tcb)
+{
+	return tcp_queue_space_rx(tcb->queue) - tcb->rx_direct_len;
+}
+
+/**
+ * Retrieves the receive path copy statistics.
+ *
+ * The ratio of \c bytes_queued to \c bytes_received shows how much
+ * received data took the extra copy through a receive buffer.
+ *
+ * \returns A pointer to the statistics.
+ */
+const struct tcp_rx_stats* tcp_get_rx_stats()
+{
+	return &tcp_rx_stats;
+}
+
+/**
+ * Probes an idle connection for a dead remote host.
+ *
+ * Once the remote host was silent for #TCP_KEEPALIVE_IDLE seconds, an empty
+ * segment with an old sequence number is sent every #TCP_KEEPALIVE_INTERVAL
+ * seconds, which the remote host has to acknowledge. After #TCP_KEEPALIVE_PROBES
+ * unanswered probes the connection is reset.
+ *
+ * \param[in] tcb The transfer control block of the idle connection.
+ * \returns \c true if the connection is still open, \c false if it has been reset.
+ */
+bool tcp_keepalive(struct tcp_tcb* tcb)
+{
+	uint32_t idle = timer_millis() - tcb->last_activity;
+	if(idle < 1000UL * (TCP_KEEPALIVE_IDLE + tcb->keepalive_probes * TCP_KEEPALIVE_INTERVAL))
+		return true;
+
+	if(tcb->keepalive_probes >= TCP_KEEPALIVE_PROBES)
+	{
+		/* the remote host is gone, free the connection */
+		tcp_send_empty(tcb, TCP_FLAG_RST | TCP_FLAG_ACK, tcb->send_base + tcb->send_next);
+		net_stats_inc(NET_STAT_TCP_KEEPALIVE_TIMEOUTS);
+
+		tcb->state = TCP_STATE_CLOSED;
+		tcb->timeout = 0;
+		tcb->callback(tcp_tcb_socket(tcb), TCP_EVT_TIMEOUT);
+		return false;
+	}
+
+	++tcb->keepalive_probes;
+	tcp_send_empty(tcb, TCP_FLAG_ACK, tcb->send_base - 1);
+
+	return true;
+}
+
+/**
+ * Resets the least recently active idle connection to make room for a new one.
+ *
+ * A connection in TIME_WAIT goes first, the one closest to expiring. It
+ * only waits for a retransmitted FIN, so it is closed silently, as if its
+ * timeout had elapsed. Without this every connection we close ourselves
+ * holds its slot and buffers for #TCP_TIMEOUT_TIME_WAIT seconds, and a
+ * few HTTP requests in a row use them all up.
+ *
+ * Otherwise only established connections without unacknowledged data which
+ * did not receive a segment for at least #TCP_EVICT_IDLE seconds are
+ * considered. Connections on the port of the new one are preferred.
+ * Connections on other ports are kept if they are within the guarantee of
+ * their listener (see tcp_listen_reserve()).
+ *
+ * \param[in] listener The listening socket which received the SYN.
+ * \returns \c true if a connection has been closed, \c false if none could be evicted.
+ */
+bool tcp_evict_idle(const struct tcp_tcb* listener)
+{
+	struct tcp_tcb* tcb;
+	struct tcp_tcb* tcb_oldest = 0;
+	bool oldest_same_port = false;
+	uint32_t now = timer_millis();
+	uint32_t idle_max = 0;
+
+	FOREACH_TCB(tcb) {
+		if(tcb->state != TCP_STATE_TIME_WAIT)
+			continue;
+
+		if(!tcb_oldest || tcb->timeout < tcb_oldest->timeout)
+			tcb_oldest = tcb;
+	}
+
+	if(tcb_oldest)
+	{
+		net_stats_inc(NET_STAT_TCP_EVICTED);
+
+		/* the application frees the socket on this event */
+		tcb_oldest->state = TCP_STATE_CLOSED;
+		tcb_oldest->timeout = 0;
+		tcb_oldest->callback(tcp_tcb_socket(tcb_oldest), TCP_EVT_CONN_CLOSED);
+
+		return true;
+	}
+
+	FOREACH_TCB(tcb) {
+		if(tcb->state != TCP_STATE_ESTABLISHED || tcp_queue_used_tx(tcb->queue) > 0)
+			continue;
+
+		uint32_t idle = now - tcb->last_activity;
+		if(idle < 1000UL * TCP_EVICT_IDLE)
+			continue;
+
+		bool same_port = tcb->port_source == listener->port_source;
+		if(!same_port && tcp_tcb_guaranteed(tcb))
+			continue;
+
+		if(tcb_oldest)
+		{
+			if(oldest_same_port && !same_port)
+				continue;
+			if(oldest_same_port == same_port && idle <= idle_max)
+				continue;
+		}
+
+		idle_max = idle;
+		tcb_oldest = tcb;
+		oldest_same_port = same_port;
+	}
+
+	if(!tcb_oldest)
+		return false;
+
+	tcp_send_empty(tcb_oldest, TCP_FLAG_RST | TCP_FLAG_ACK, tcb_oldest->send_base + tcb_oldest->send_next);
+	net_stats_inc(NET_STAT_TCP_EVICTED);
+
+	/* the application frees the socket on this event */
+	tcb_oldest->state = TCP_STATE_CLOSED;
+	tcb_oldest->timeout = 0;
+	tcb_oldest->callback(tcp_tcb_socket(tcb_oldest), TCP_EVT_RESET);
+
+	return true;
+}
+
 /**
  * Allocates a TCP socket.
  *
@@ -304,7 +729,7 @@ bool tcp_connect(int socket, const uint8_t* ip, uint16_t port)
 	tcp_tcb_reset(tcb);
 
 	/* allocate data queue or clear it */
-	tcb->queue = tcp_queue_alloc();
+	tcb->queue = tcp_queue_alloc(tcp_queue_reservations(0));
 	if(!tcb->queue)
 		return false;
 
@@ -341,6 +766,7 @@ bool tcp_disconnect(int socket)
 			tcb->state = TCP_STATE_START_CLOSE;
 			if(tcb->timeout < 1)
 				tcb->timeout = 1;
+			tcp_output_schedule(tcb);
 			return true;
 		default:
 			/* TODO: handle other cases */
@@ -382,6 +808,31 @@ bool tcp_listen(int socket, uint16_t port)
 	return true;
 }
 
+/**
+ * Guarantees buffer space for connections accepted on a listening socket.
+ *
+ * Up to \a connections connections on the port can always be set up,
+ * no matter how many connections other ports currently hold. This keeps
+ * e.g. a burst of browser connections from locking out control traffic.
+ *
+ * \param[in] socket The identifier of the listening socket.
+ * \param[in] connections The number of connections to guarantee.
+ * \returns \c true if the guarantee has been set, \c false on failure.
+ */
+bool tcp_listen_reserve(int socket, uint8_t connections)
+{
+	if(!tcp_socket_valid(socket))
+		return false;
+
+	struct tcp_tcb* tcb = &tcp_tcbs[socket];
+	if(tcb->state != TCP_STATE_LISTEN)
+		return false;
+
+	tcb->reserved = connections;
+
+	return true;
+}
+
 /**
  * Accepts an incoming connection.
  *
@@ -435,10 +886,9 @@ int16_t tcp_write(int socket, const uint8_t* data, uint16_t data_len)
 	/* put data into queue */
 	int16_t queued = tcp_queue_put_tx(tcb->queue, data, data_len);
 
-	/* try to transmit on next timeout */
-	if( tcp_queue_used_tx(tcb->queue) > 0 ) {
-		tcb->timeout = 1;
-	}
+	/* transmit on the next timer tick */
+	if(queued > 0)
+		tcp_output_schedule(tcb);
 
 	return queued;
 }
@@ -522,6 +972,18 @@ int16_t tcp_peek(int socket, uint8_t* buffer, uint16_t offset, uint16_t buffer_l
 	if(buffer_len > INT16_MAX)
 		buffer_len = INT16_MAX;
 
+	/* peek data from the received packet */
+	if(tcb->rx_direct)
+	{
+		if(!buffer || offset >= tcb->rx_direct_len)
+			return 0;
+		if(buffer_len > tcb->rx_direct_len - offset)
+			buffer_len = tcb->rx_direct_len - offset;
+
+		memcpy(buffer, tcb->rx_direct + offset, buffer_len);
+		return buffer_len;
+	}
+
 	/* peek data from queue */
 	return tcp_queue_peek_rx(tcb->queue, buffer, offset, buffer_len);
 }
@@ -545,6 +1007,18 @@ int16_t tcp_skip(int socket, uint16_t len)
 	if(len > INT16_MAX)
 		len = INT16_MAX;
 
+	/* skip data of the received packet */
+	if(tcb->rx_direct)
+	{
+		if(len > tcb->rx_direct_len)
+			len = tcb->rx_direct_len;
+
+		tcb->rx_direct += len;
+		tcb->rx_direct_len -= len;
+		tcp_rx_stats.bytes_direct += len;
+		return len;
+	}
+
 	/* peek data from queue */
 	return tcp_queue_skip_rx(tcb->queue, len);
 }
@@ -574,9 +1048,9 @@ int16_t tcp_reserve(int socket, uint16_t len)
 	/* get pointer to the empty part of the queue transmit buffer */
 	int16_t queued = tcp_queue_reserve_tx(tcb->queue, len);
 
-	/* try to transmit on next timeout */
-	if(tcp_queue_used_tx(tcb->queue) > 0)
-		tcb->timeout = 1;
+	/* transmit on the next timer tick */
+	if(queued > 0)
+		tcp_output_schedule(tcb);
 
 	return queued;
 }
@@ -601,6 +1075,9 @@ uint8_t* tcp_buffer_rx(int socket)
 	if(tcb->state == TCP_STATE_UNUSED)
 		return 0;
 
+	/* the caller may keep pointers into the data, so it has to be queued */
+	tcp_rx_direct_flush(tcb);
+
 	/* get pointer to the occupied part of the queue receive buffer */
 	return tcp_queue_used_buffer_rx(tcb->queue);
 }
@@ -646,7 +1123,7 @@ int16_t tcp_buffer_used_rx(int socket)
 	if(tcb->state == TCP_STATE_UNUSED)
 		return -1;
 
-	return tcp_queue_used_rx(tcb->queue);
+	return tcp_queue_used_rx(tcb->queue) + tcb->rx_direct_len;
 }
 
 /**
@@ -665,7 +1142,7 @@ int16_t tcp_buffer_space_rx(int socket)
 	if(tcb->state == TCP_STATE_UNUSED)
 		return -1;
 
-	return tcp_queue_space_rx(tcb->queue);
+	return tcp_window(tcb);
 }
 
 /**
@@ -791,29 +1268,28 @@ void tcp_process_timeout(struct tcp_tcb* tcb)
 		{
 			if(tcp_queue_used_tx(tcb->queue) > 0)
 			{
-				if(++tcb->retx > TCP_MAX_RETRY)
-				{
-					tcb->state = TCP_STATE_CLOSED;
-					tcb->callback(socket, TCP_EVT_TIMEOUT);
-
-					return;
-				}
-
-				/* resend queued data */
-				tcb->send_next = 0;
-				tcp_send_packet(tcb, TCP_FLAG_ACK, true);
+				/* Data in flight is resent by the retransmission timer,
+				 * or from here if that timer is not running. Data never
+				 * sent, e.g. after a failed transmission, is left to
+				 * tcp_output(), which also probes a closed window.
+				 */
+				if(tcb->send_next < 1)
+					tcp_output_schedule(tcb);
+				else if(!tcb->rtx_armed)
+					tcp_retransmit(tcb);
+				if(tcb->state != TCP_STATE_CLOSED)
+					tcb->timeout = TCP_TIMEOUT_IDLE;
 			}
 			else if(tcb->state == TCP_STATE_START_CLOSE)
 			{
 				/* send FIN to actively initiate closing the connection */
-				tcp_send_packet(tcb, TCP_FLAG_ACK | TCP_FLAG_FIN, true);
-
-				tcb->state = TCP_STATE_FIN_WAIT_1;
-				tcb->timeout = TCP_TIMEOUT_GENERIC;
-				tcb->retx = 0;
+				tcp_send_fin(tcb);
 			}
 			else
 			{
+				if(!tcp_keepalive(tcb))
+					return;
+
 				tcb->callback(socket, TCP_EVT_CONN_IDLE);
 				tcb->timeout = 1;
 			}
@@ -993,7 +1469,16 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 			}
 
 			struct tcp_tcb* tcb_new = tcp_tcb_alloc();
-			struct tcp_queue* tcb_queue = tcp_queue_alloc();
+			struct tcp_queue* tcb_queue = tcp_queue_alloc(tcp_queue_reservations(tcb));
+			if((!tcb_new || !tcb_queue) && tcp_evict_idle(tcb))
+			{
+				/* retry with the resources of the oldest idle connection */
+				tcp_tcb_free(tcb_new);
+				tcp_queue_free(tcb_queue);
+
+				tcb_new = tcp_tcb_alloc();
+				tcb_queue = tcp_queue_alloc(tcp_queue_reservations(tcb));
+			}
 			if(!tcb_new || !tcb_queue)
 			{
 				/* We do not have any unused connection slots, so
@@ -1004,6 +1489,7 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 
 				tcp_tcb_free(tcb_new);
 				tcp_queue_free(tcb_queue);
+				net_stats_inc(NET_STAT_TCP_REFUSED_NO_SLOT);
 				return false;
 			}
 
@@ -1015,6 +1501,7 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 			tcb_new->port_source = tcb->port_source;
 			tcb_new->port_destination = ntoh16(packet->port_source);
 			tcb_new->acked = ntoh32(packet->seq) + 1;
+			tcb_new->window = ntoh16(packet->window);
 			tcb_new->queue = tcb_queue;
 
 			/* ask application wether it accepts the new tcb */
@@ -1023,6 +1510,8 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 			/* abort if application does not accept tcb */
 			if(tcb_new->state != TCP_STATE_ACCEPTED)
 			{
+				net_stats_inc(NET_STAT_TCP_REFUSED_BY_APP);
+
 				/* send RST */
 				tcp_send_rst(ip, packet, packet_len);
 				tcp_tcb_free(tcb_new);
@@ -1060,6 +1549,8 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 
 				if(packet->flags & TCP_FLAG_RST)
 				{
+					net_stats_inc(NET_STAT_TCP_RX_RESETS);
+
 					tcb->state = TCP_STATE_CLOSED;
 					tcb->timeout = 0;
 					tcb->callback(socket, TCP_EVT_RESET);
@@ -1078,6 +1569,7 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 				tcp_parse_options(tcb, packet);
 
 				tcb->acked = ntoh32(packet->seq) + 1;
+				tcb->window = ntoh16(packet->window);
 
 				if(packet->flags & TCP_FLAG_ACK)
 				{
@@ -1127,6 +1619,7 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 		/* Packet is out of sequence.
 		 * Tell our position to the remote host.
 		 */
+		net_stats_inc(NET_STAT_TCP_RX_OUT_OF_WINDOW);
 		tcp_send_packet(tcb, TCP_FLAG_ACK, false);
 
 		return false;
@@ -1147,6 +1640,9 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 		{
 			if(packet->flags & (TCP_FLAG_RST | TCP_FLAG_SYN))
 			{
+				if(packet->flags & TCP_FLAG_RST)
+					net_stats_inc(NET_STAT_TCP_RX_RESETS);
+
 				tcb->state = TCP_STATE_CLOSED;
 				tcb->timeout = 0;
 				tcb->callback(socket, TCP_EVT_RESET);
@@ -1171,6 +1667,7 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 				return false;
 
 			++tcb->send_base; /* SYN counts as an octet */
+			tcb->window = ntoh16(packet->window);
 
 			tcb->state = TCP_STATE_ESTABLISHED;
 			tcb->timeout = TCP_TIMEOUT_IDLE; /* timeout for idle event generation */
@@ -1190,7 +1687,47 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 			uint16_t queue_used = tcp_queue_used_tx(tcb->queue);
 
 			if(tcb->send_base == packet_ack)
+			{
+				uint16_t packet_window = ntoh16(packet->window);
+
+				if(tcb->send_next > 0 &&
+				   packet_window == tcb->window &&
+				   packet_len == (packet->offset >> 4) * 4 &&
+				   !(packet->flags & TCP_FLAG_FIN)
+				  )
+				{
+					/* Duplicate ACK for data in flight. Some segments
+					 * behind the oldest one arrived, so it was probably
+					 * lost. Resend it without waiting for the timeout.
+					 * The count stops at the threshold, so the same hole
+					 * is not resent again once it would wrap around.
+					 */
+					if(tcb->dupacks < TCP_DUPACK_THRESHOLD &&
+					   ++tcb->dupacks == TCP_DUPACK_THRESHOLD)
+					{
+						net_stats_inc(NET_STAT_TCP_FAST_RETRANSMITS);
+
+						tcb->rtt_active = false;
+						tcb->send_next = 0;
+						tcp_send_segments(tcb, TCP_FLAG_ACK, true, 1);
+						tcp_rtx_arm(tcb);
+					}
+					break;
+				}
+
+				/* a window update may allow more segments in flight */
+				tcb->window = packet_window;
+				if(tcb->send_next < queue_used &&
+				   !tcp_send_packet(tcb, TCP_FLAG_ACK, true)
+				  )
+				{
+					tcb->state = TCP_STATE_CLOSED;
+					tcb->timeout = 0;
+					tcb->callback(socket, TCP_EVT_ERROR);
+					return false;
+				}
 				break;
+			}
 
 			if(((tcb->send_base + queue_used > tcb->send_base) && packet_ack > tcb->send_base && packet_ack <= tcb->send_base + queue_used) ||
 			   ((tcb->send_base + queue_used < tcb->send_base) && (packet_ack > tcb->send_base || packet_ack <= tcb->send_base + queue_used))
@@ -1212,32 +1749,24 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 				tcb->window = ntoh16(packet->window);
 
 				/* do round trip time estimation */
-				if(tcb->timeout > 0 && tcb->retx == 0)
+				if(tcb->rtt_active && (int32_t) (packet_ack - tcb->rtt_seq) >= 0)
 				{
-					/* Taken out of
-					 * "Congestion Avoidance and Control"
-					 * by Van Jacobson in
-					 * "Proceedings of SIGCOMM '88"
-					 * Stanford, 1988, ACM.
-					 */
-					int8_t m = tcb->rto - tcb->timeout;
-					m -= tcb->sa >> 3;
-					tcb->sa += m;
-					if(m < 0)
-						m = -m;
-					m -= tcb->sv >> 2;
-					tcb->sv += m;
-					tcb->rto = (tcb->sa >> 3) + tcb->sv;
+					tcb->rtt_active = false;
+					tcp_rtt_sample(tcb, (timebase_now32() - tcb->rtt_start) / (1000 * TIMEBASE_TICKS_PER_US));
 				}
 
-				/* reset retransmission counter */
+				/* reset retransmission and duplicate ACK counters */
 				tcb->retx = 0;
+				tcb->dupacks = 0;
 
 				/* inform application that some data has been acknowledged */
 				tcb->callback(socket, TCP_EVT_DATA_SENT);
 
 				if(tcp_queue_used_tx(tcb->queue) > 0)
 				{
+					/* restart the retransmission timer for the rest in flight */
+					tcp_rtx_arm(tcb);
+
 					/* use this opportunity to keep data flowing */
 					if(!tcp_send_packet(tcb, TCP_FLAG_ACK, true))
 					{
@@ -1251,12 +1780,9 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 				{
 					/* The user may call tcp_disconnect() even if the socket still has
 					 * data in its outgoing queue. But now, all outgoing data has been
-					 * acknowledged.
-					 * As the FIN is sent from a timeout event, we shorten the timeout
-					 * period, which may be much longer depending on the round trip
-					 * time estimation for the last data packet.
+					 * acknowledged, so send the FIN on the next tick.
 					 */
-					tcb->timeout = 1;
+					tcp_output_schedule(tcb);
 				}
 				else
 				{
@@ -1355,13 +1881,27 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 
 			if(packet_data_len > 0)
 			{
-				/* put data into receive buffer */
-				data_new = tcp_queue_put_rx(tcb->queue,
-											(uint8_t*) (packet) + (packet->offset >> 4) * 4,
-											packet_data_len
-										   );
+				const uint8_t* packet_data = (const uint8_t*) (packet) + (packet->offset >> 4) * 4;
+
+				if(tcp_queue_used_rx(tcb->queue) < 1 && packet_data_len <= tcp_queue_space_rx(tcb->queue))
+				{
+					/* Let the application read the data straight from the
+					 * packet. Whatever it leaves is queued afterwards, which
+					 * always succeeds as the receive buffer is empty.
+					 */
+					tcb->rx_direct = packet_data;
+					tcb->rx_direct_len = packet_data_len;
+					data_new = packet_data_len;
+				}
+				else
+				{
+					/* put data into receive buffer */
+					data_new = tcp_queue_put_rx(tcb->queue, packet_data, packet_data_len);
+					tcp_rx_stats.bytes_queued += data_new;
+				}
 
 				tcb->acked += data_new;
+				tcp_rx_stats.bytes_received += data_new;
 
 				if(data_new > 0)
 				{
@@ -1380,6 +1920,9 @@ bool tcp_state_machine(struct tcp_tcb* tcb, const struct tcp_header* packet, uin
 
 					/* inform application */
 					tcb->callback(socket, TCP_EVT_DATA_RECEIVED);
+
+					/* keep what the application did not read */
+					tcp_rx_direct_flush(tcb);
 				}
 			}
 
@@ -1557,6 +2100,8 @@ void tcp_tcb_free(struct tcp_tcb* tcb)
 
 	tcb->state = TCP_STATE_UNUSED;
 	tcb->queue = 0;
+	tcb->rx_direct = 0;
+	tcb->rx_direct_len = 0;
 }
 
 /**
@@ -1577,8 +2122,7 @@ void tcp_tcb_reset(struct tcp_tcb* tcb)
 	tcb->state = TCP_STATE_CLOSED;
 	tcb->callback = callback;
 	tcb->mss = 536;
-	tcb->rto = TCP_TIMEOUT_RTT;
-	tcb->sv = TCP_TIMEOUT_RTT / 2;
+	tcb->rto = TCP_RTO_INITIAL;
 }
 
 /**
@@ -1592,7 +2136,7 @@ int tcp_tcb_socket(const struct tcp_tcb* tcb)
 	if(!tcb)
 		return -1;
 
-	int socket = ((int) tcb - (int) &tcp_tcbs[0]) / sizeof(*tcb);
+	int socket = tcb - &tcp_tcbs[0];
 	if(!tcp_socket_valid(socket))
 		return -1;
 
@@ -1640,6 +2184,72 @@ uint16_t tcp_port_find_unused()
 	return port_counter;
 }
 
+/**
+ * Checks whether a connection is covered by the guarantee of its listening socket.
+ *
+ * \param[in] tcb The connection to check.
+ * \returns \c true if closing it would leave its port with fewer connections than reserved.
+ */
+bool tcp_tcb_guaranteed(const struct tcp_tcb* tcb)
+{
+	struct tcp_tcb* listener;
+	struct tcp_tcb* tcb_conn;
+
+	FOREACH_TCB(listener) {
+		if(listener->state != TCP_STATE_LISTEN || listener->reserved < 1 ||
+		   listener->port_source != tcb->port_source)
+			continue;
+
+		uint8_t used = 0;
+		FOREACH_TCB(tcb_conn) {
+			if(tcb_conn->queue && tcb_conn->port_source == tcb->port_source)
+				++used;
+		}
+
+		return used <= listener->reserved;
+	}
+
+	return false;
+}
+
+/**
+ * Counts the connections whose buffers must be kept available for listening sockets.
+ *
+ * These are the connections guaranteed by tcp_listen_reserve() which
+ * are currently not set up.
+ *
+ * \param[in] listener The listening socket for which a connection is about to be set up, or \c NULL.
+ * \returns The number of connections to keep buffers available for.
+ */
+uint8_t tcp_queue_reservations(const struct tcp_tcb* listener)
+{
+	struct tcp_tcb* tcb;
+	struct tcp_tcb* tcb_conn;
+	uint8_t reserved = 0;
+
+	FOREACH_TCB(tcb) {
+		if(tcb->state != TCP_STATE_LISTEN || tcb->reserved < 1)
+			continue;
+
+		uint8_t used = 0;
+		FOREACH_TCB(tcb_conn) {
+			if(tcb_conn->queue && tcb_conn->port_source == tcb->port_source)
+				++used;
+		}
+
+		if(used >= tcb->reserved)
+			continue;
+
+		reserved += tcb->reserved - used;
+
+		/* the new connection takes one of its listener's guarantees */
+		if(tcb == listener)
+			--reserved;
+	}
+
+	return reserved;
+}
+
 /**
  * Calculates the checksum of a TCP packet.
  *
@@ -1651,9 +2261,7 @@ uint16_t tcp_port_find_unused()
 uint16_t tcp_calc_checksum(const uint8_t* ip_destination, const struct tcp_header* packet, uint16_t packet_len)
 {
 	/* pseudo header */
-	uint16_t checksum = IP_PROTOCOL_TCP + packet_len;
-	checksum = net_calc_checksum(checksum, ip_get_address(), 4, 4);
-	checksum = net_calc_checksum(checksum, ip_destination, 4, 4);
+	uint16_t checksum = ip_calc_pseudo_checksum(ip_destination, IP_PROTOCOL_TCP, packet_len);
 
 	/* real package */
 	return ~net_calc_checksum(checksum, (uint8_t*) packet, packet_len, 16);
@@ -1662,12 +2270,32 @@ uint16_t tcp_calc_checksum(const uint8_t* ip_destination, const struct tcp_heade
 /**
  * Send data queued for a connection.
  *
+ * All queued data not yet sent is transmitted, as far as the window
+ * of the remote host allows.
+ *
  * \param[in] tcb The transfer control block associated with the connection.
  * \param[in] flags The TCP flags which should be set in the packet(s).
  * \param[in] send_data Determines wether non-empty or empty packets should be sent.
  * \returns \c true if the packet(s) was/were successfully sent, \c false otherwise.
  */
 bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
+{
+	return tcp_send_segments(tcb, flags, send_data, 0xff);
+}
+
+/**
+ * Send up to a given number of segments of the data queued for a connection.
+ *
+ * Sending starts at the first byte not yet sent, so resetting \c send_next
+ * beforehand retransmits from the oldest unacknowledged byte.
+ *
+ * \param[in] tcb The transfer control block associated with the connection.
+ * \param[in] flags The TCP flags which should be set in the packet(s).
+ * \param[in] send_data Determines wether non-empty or empty packets should be sent.
+ * \param[in] max_segments The maximum number of segments to send.
+ * \returns \c true if the packet(s) was/were successfully sent, \c false otherwise.
+ */
+bool tcp_send_segments(struct tcp_tcb* tcb, uint8_t flags, bool send_data, uint8_t max_segments)
 {
 	if(!tcb || (flags & TCP_FLAG_RST)) {
 		return false;
@@ -1686,7 +2314,7 @@ bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
 	packet_header->port_source = hton16(tcb->port_source);
 	packet_header->port_destination = hton16(tcb->port_destination);
 	packet_header->ack = hton32(tcb->acked);
-	packet_header->window = hton16(tcp_queue_space_rx(tcb->queue));
+	packet_header->window = hton16(tcp_window(tcb));
 	packet_header->urgent = HTON16(0x0000);
 
 	uint16_t data_available = tcp_queue_used_tx(tcb->queue);
@@ -1737,7 +2365,11 @@ bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
 	uint16_t data_pos = tcb->send_next;
 	bool success = true;
 
-	data_available -= data_pos;
+	/* the window may have shrunk below what is already in flight */
+	if(data_available > data_pos)
+		data_available -= data_pos;
+	else
+		data_available = 0;
 	packet_seq += data_pos;
 	do {
 		uint16_t packet_data_len = 0;
@@ -1757,18 +2389,27 @@ bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
 				 * we split it into two halves, which effectively
 				 * disables delayed ACKs at the remote host.
 				 */
-				if(!data_pos && packet_data_len > 1) {
-					//packet_data_len /= 2;
+				if(!data_pos && packet_data_len > 1 && max_segments > 1) {
+					packet_data_len = (packet_data_len + 1) / 2;
 				}
 			}
 
 			tcp_queue_peek_tx( tcb->queue, packet_data, data_pos, packet_data_len );
 
 			if(packet_data_len > 0) {
-				/* start retransmission timer */
-				tcb->timeout = tcb->rto << (tcb->retx > 4 ? 4 : tcb->retx); /* exponential backoff */
-				if(tcb->timeout < 1) {
-					tcb->timeout = 1;
+				/* Start the retransmission timer for the oldest
+				 * unacknowledged segment only. Further segments
+				 * must not push it out, the timer is restarted
+				 * when an ACK advances the send base.
+				 */
+				if(!tcb->rtx_armed || !data_pos)
+					tcp_rtx_arm(tcb);
+
+				/* time one segment per round trip, never a resent one */
+				if(!tcb->rtt_active && !tcb->retx && tcb->dupacks < TCP_DUPACK_THRESHOLD) {
+					tcb->rtt_active = true;
+					tcb->rtt_seq = packet_seq + packet_data_len;
+					tcb->rtt_start = timebase_now32();
 				}
 			}
 		}
@@ -1783,7 +2424,11 @@ bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
 			packet_header->flags = flags;
 
 		/* calculate header checksum */
+#ifdef HAL_CHECKSUM_OFFLOAD
+		packet_header->checksum = hton16(ip_calc_pseudo_checksum(tcb->ip, IP_PROTOCOL_TCP, packet_header_size + packet_data_len));
+#else
 		packet_header->checksum = hton16(tcp_calc_checksum(tcb->ip, packet_header, packet_header_size + packet_data_len));
+#endif
 
 		/* transmit packet */
 		success = success && ip_send_packet(tcb->ip,
@@ -1797,7 +2442,7 @@ bool tcp_send_packet(struct tcp_tcb* tcb, uint8_t flags, bool send_data)
 			data_available -= packet_data_len;
 		}
 
-	} while(success && send_data && data_available > 0);
+	} while(success && send_data && data_available > 0 && --max_segments);
 
 	tcb->send_next = data_pos;
 
@@ -1845,7 +2490,13 @@ bool tcp_send_rst(const uint8_t* ip_destination, const struct tcp_header* packet
 	}
 
 	/* calculate header checksum */
+#ifdef HAL_CHECKSUM_OFFLOAD
+	packet_header->checksum = hton16(ip_calc_pseudo_checksum(ip_destination, IP_PROTOCOL_TCP, sizeof(*packet_header)));
+#else
 	packet_header->checksum = hton16(tcp_calc_checksum(ip_destination, packet_header, sizeof(*packet_header)));
+#endif
+
+	net_stats_inc(NET_STAT_TCP_TX_RESETS);
 
 	/* transmit packet */
 	return ip_send_packet(ip_destination,
@@ -1853,3 +2504,42 @@ bool tcp_send_rst(const uint8_t* ip_destination, const struct tcp_header* packet
 						  sizeof(*packet_header)
 						 );
 }
+
+/**
+ * Send a TCP packet without data and options on a connection.
+ *
+ * \param[in] tcb The transfer control block associated with the connection.
+ * \param[in] flags The TCP flags which should be set in the packet.
+ * \param[in] seq The sequence number of the packet.
+ * \returns \c true if the packet has successfully been sent, \c false on failure.
+ */
+bool tcp_send_empty(struct tcp_tcb* tcb, uint8_t flags, uint32_t seq)
+{
+	struct tcp_header* packet_header = (struct tcp_header*) ip_get_buffer();
+
+	/* prepare packet header */
+	memset(packet_header, 0, sizeof(*packet_header));
+	packet_header->port_source = hton16(tcb->port_source);
+	packet_header->port_destination = hton16(tcb->port_destination);
+	packet_header->seq = hton32(seq);
+	packet_header->ack = hton32(tcb->acked);
+	packet_header->offset = (sizeof(*packet_header) / 4) << 4;
+	packet_header->flags = flags;
+	packet_header->window = hton16(tcp_window(tcb));
+
+	/* calculate header checksum */
+#ifdef HAL_CHECKSUM_OFFLOAD
+	packet_header->checksum = hton16(ip_calc_pseudo_checksum(tcb->ip, IP_PROTOCOL_TCP, sizeof(*packet_header)));
+#else
+	packet_header->checksum = hton16(tcp_calc_checksum(tcb->ip, packet_header, sizeof(*packet_header)));
+#endif
+
+	if(flags & TCP_FLAG_RST)
+		net_stats_inc(NET_STAT_TCP_TX_RESETS);
+
+	/* transmit packet */
+	return ip_send_packet(tcb->ip,
+						  IP_PROTOCOL_TCP,
+						  sizeof(*packet_header)
+						 );
+}
@@ -67,6 +67,19 @@ struct tcp_header;
 
 typedef void (*tcp_callback)(int socket, enum tcp_event event);
 
+/**
+ * Receive path copy statistics.
+ */
+struct tcp_rx_stats
+{
+    /** The number of payload bytes accepted from incoming segments. */
+    uint32_t bytes_received;
+    /** The number of payload bytes copied into receive buffers. */
+    uint32_t bytes_queued;
+    /** The number of payload bytes read by applications straight from the received packet. */
+    uint32_t bytes_direct;
+};
+
 void tcp_init();
 
 bool tcp_handle_packet(const uint8_t* ip, const struct tcp_header* packet, uint16_t packet_len);
@@ -77,6 +90,7 @@ bool tcp_socket_free(int socket);
 bool tcp_connect(int socket, const uint8_t* ip, uint16_t port);
 bool tcp_disconnect(int socket);
 bool tcp_listen(int socket, uint16_t port);
+bool tcp_listen_reserve(int socket, uint8_t connections);
 bool tcp_accept(int socket, tcp_callback callback);
 
 int16_t tcp_write(int socket, const uint8_t* data, uint16_t data_len);
@@ -94,6 +108,8 @@ int16_t tcp_buffer_space_rx(int socket);
 int16_t tcp_buffer_used_tx(int socket);
 int16_t tcp_buffer_space_tx(int socket);
 
+const struct tcp_rx_stats* tcp_get_rx_stats();
+
 
 #define tcp_socket_valid(socket) (((unsigned int) (socket)) < TCP_MAX_SOCKET_COUNT)
 
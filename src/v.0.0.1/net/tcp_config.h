@@ -50,7 +50,7 @@
  *
  * Basically, this is TCP_MAX_SOCKET_COUNT without the listening connections.
  */
-#define TCP_MAX_CONNECTION_COUNT	5 // ???
+#define TCP_MAX_CONNECTION_COUNT	10
 
 /**
  * The maximum segment size of outgoing TCP packets.
@@ -63,13 +63,52 @@
 #define TCP_RECEIVE_BUFFER_SIZE TCP_MSS
 /**
  * The transmit buffer size per connection.
+ *
+ * Everything up to this size may be in flight at once, as far as the
+ * window of the remote host allows. Several segments per connection keep
+ * bulk transfers from degrading to one segment per round trip.
+ */
+#define TCP_TRANSMIT_BUFFER_SIZE (3 * TCP_MSS)
+/**
+ * The transmit buffer size a connection gets at least when the buffer pool runs low.
  */
-#define TCP_TRANSMIT_BUFFER_SIZE TCP_MSS
+#define TCP_TRANSMIT_BUFFER_SIZE_MIN TCP_MSS
 
 /**
- * The default round-trip-time estimation in seconds.
+ * The size in bytes of a buffer pool block.
+ *
+ * The receive and transmit buffers of all connections are allocated
+ * from a common pool in units of this size when a connection is set up.
+ */
+#define TCP_POOL_BLOCK_SIZE			128
+/**
+ * The number of buffer pool blocks.
+ *
+ * \note The pool is static and, like all of .data/.bss, linked into
+ *       the external SRAM (see arch/xmem.c), so size it against that.
+ */
+#define TCP_POOL_BLOCK_COUNT		240
+
+/**
+ * The retransmission timeout in milliseconds before the first round-trip-time sample.
+ */
+#define TCP_RTO_INITIAL				1000
+/**
+ * The lower bound of the retransmission timeout in milliseconds.
+ *
+ * The retransmission timer is only checked every 10 ms timer tick, so
+ * a timeout can fire up to one tick late. The bound spans a few ticks to
+ * keep that jitter from causing spurious retransmissions on a fast link.
+ */
+#define TCP_RTO_MIN					30
+/**
+ * The upper bound of the retransmission timeout in milliseconds, including backoff.
+ */
+#define TCP_RTO_MAX					8000
+/**
+ * The number of duplicate ACKs which trigger a fast retransmit.
  */
-#define TCP_TIMEOUT_RTT				1
+#define TCP_DUPACK_THRESHOLD		3
 /**
  * Timeout in seconds a connection must be idle before generating an event.
  */
@@ -88,6 +127,24 @@
  */
 #define TCP_MAX_RETRY				5
 
+/**
+ * Time in seconds without a segment from the remote host before it gets probed.
+ */
+#define TCP_KEEPALIVE_IDLE			30
+/**
+ * Time in seconds between two keep-alive probes.
+ */
+#define TCP_KEEPALIVE_INTERVAL		5
+/**
+ * The number of unanswered keep-alive probes after which the connection is reset.
+ */
+#define TCP_KEEPALIVE_PROBES		3
+/**
+ * Time in seconds without a segment from the remote host after which an
+ * established connection may be reset to make room for a new one.
+ */
+#define TCP_EVICT_IDLE				10
+
 /**
  * @}
  * @}
@@ -38,11 +38,13 @@
  * \internal
  * A ring buffer.
  *
- * This struct just contains the header. The data area directly follows
- * in memory. Its end is determined from the \a end pointer.
+ * This struct just contains the header. The data area is a run of
+ * contiguous blocks taken from the buffer pool.
  */
 struct tcp_queue_head
 {
+    /** Points to the beginning of the data area of the ring buffer. */
+    uint8_t* start;
     /** Points to the ring buffer byte to be read next. */
     uint8_t* pos;
     /** Points behind the end of the data area of the ring buffer. */
@@ -64,17 +66,34 @@ struct tcp_queue
 {
     /** The receive ring header. */
     struct tcp_queue_head rx_head;
-    /** The receive buffer. */
-    uint8_t rx_buffer[ TCP_RECEIVE_BUFFER_SIZE ];
-
     /** The transmit ring header. */
     struct tcp_queue_head tx_head;
-    /** The transmit buffer. */
-    uint8_t tx_buffer[ TCP_TRANSMIT_BUFFER_SIZE ];
 };
 
+/** The number of pool blocks a buffer of the given size occupies. */
+#define TCP_QUEUE_BLOCKS(size) (((size) + TCP_POOL_BLOCK_SIZE - 1) / TCP_POOL_BLOCK_SIZE)
+
+/** The number of pool blocks a connection needs at least. */
+#define TCP_QUEUE_BLOCKS_MIN (TCP_QUEUE_BLOCKS(TCP_RECEIVE_BUFFER_SIZE) + TCP_QUEUE_BLOCKS(TCP_TRANSMIT_BUFFER_SIZE_MIN))
+
 static struct tcp_queue tcp_queue_queues[ TCP_MAX_CONNECTION_COUNT ];
 
+/**
+ * \internal
+ * The buffer pool shared by all queues.
+ *
+ * Like all of .data/.bss, it is linked into the external SRAM (see arch/xmem.c).
+ */
+static uint8_t tcp_queue_pool[ TCP_POOL_BLOCK_COUNT ][ TCP_POOL_BLOCK_SIZE ];
+/** One bit per pool block, set when the block is in use. */
+static uint8_t tcp_queue_pool_used[ (TCP_POOL_BLOCK_COUNT + 7) / 8 ];
+/** The number of unused pool blocks. */
+static uint16_t tcp_queue_pool_free = TCP_POOL_BLOCK_COUNT;
+
+static bool tcp_queue_head_alloc(struct tcp_queue_head* queue_head, uint16_t blocks);
+static void tcp_queue_head_free(struct tcp_queue_head* queue_head);
+static void tcp_queue_pool_mark(uint16_t block, uint16_t count, bool used);
+
 static uint16_t tcp_queue_put(struct tcp_queue_head* queue_head, const uint8_t* data, uint16_t data_len);
 static uint16_t tcp_queue_get(struct tcp_queue_head* queue_head, uint8_t* buffer, uint16_t buffer_len);
 static uint16_t tcp_queue_peek(const struct tcp_queue_head* queue_head, uint8_t* buffer, uint16_t offset, uint16_t length);
@@ -89,25 +108,43 @@ static uint16_t tcp_queue_space(const struct tcp_queue_head* queue_head);
  * \internal
  * Allocates a data queue.
  *
- * \returns The allocated data queue.
+ * The buffers are taken from the block pool. The transmit buffer gets
+ * #TCP_TRANSMIT_BUFFER_SIZE bytes if the pool allows, but shrinks down
+ * to #TCP_TRANSMIT_BUFFER_SIZE_MIN when it runs low.
+ *
+ * \param[in] reserved The number of connections whose minimum buffers must stay available for others.
+ * \returns The allocated data queue on success, \c NULL if no queue or not enough buffer space is left.
  */
-struct tcp_queue* tcp_queue_alloc()
+struct tcp_queue* tcp_queue_alloc(uint8_t reserved)
 {
+    uint16_t blocks_rx = TCP_QUEUE_BLOCKS(TCP_RECEIVE_BUFFER_SIZE);
+    uint16_t blocks_tx = TCP_QUEUE_BLOCKS(TCP_TRANSMIT_BUFFER_SIZE);
+    uint16_t blocks_reserved = reserved * TCP_QUEUE_BLOCKS_MIN;
+
+    if(tcp_queue_pool_free < blocks_reserved + TCP_QUEUE_BLOCKS_MIN)
+        return 0;
+    if(tcp_queue_pool_free < blocks_reserved + blocks_rx + blocks_tx)
+        blocks_tx = tcp_queue_pool_free - blocks_reserved - blocks_rx;
+
     struct tcp_queue* queue = &tcp_queue_queues[0];
     for(; queue < &tcp_queue_queues[TCP_MAX_CONNECTION_COUNT]; ++queue)
     {
-        if(queue->rx_head.pos == 0 && queue->tx_head.pos == 0)
-        {
-            queue->rx_head.pos = &queue->rx_buffer[0];
-            queue->rx_head.end = queue->rx_head.pos + sizeof(queue->rx_buffer);
-            queue->rx_head.used = 0;
+        if(queue->rx_head.start != 0 || queue->tx_head.start != 0)
+            continue;
 
-            queue->tx_head.pos = &queue->tx_buffer[0];
-            queue->tx_head.end = queue->tx_head.pos + sizeof(queue->tx_buffer);
-            queue->tx_head.used = 0;
-
-            return queue;
+        /* The pool may be fragmented, so retry with smaller
+         * transmit buffers before giving up.
+         */
+        if(!tcp_queue_head_alloc(&queue->rx_head, blocks_rx))
+            return 0;
+        for(; blocks_tx >= TCP_QUEUE_BLOCKS(TCP_TRANSMIT_BUFFER_SIZE_MIN); --blocks_tx)
+        {
+            if(tcp_queue_head_alloc(&queue->tx_head, blocks_tx))
+                return queue;
         }
+
+        tcp_queue_head_free(&queue->rx_head);
+        return 0;
     }
 
     return 0;
@@ -124,8 +161,19 @@ void tcp_queue_free(struct tcp_queue* queue)
     if(!queue)
         return;
 
-    queue->rx_head.pos = 0;
-    queue->tx_head.pos = 0;
+    tcp_queue_head_free(&queue->rx_head);
+    tcp_queue_head_free(&queue->tx_head);
+}
+
+/**
+ * \internal
+ * Retrieves the number of unused blocks in the buffer pool.
+ *
+ * \returns The number of unused pool blocks.
+ */
+uint16_t tcp_queue_pool_space()
+{
+    return tcp_queue_pool_free;
 }
 
 /**
@@ -378,9 +426,9 @@ uint16_t tcp_queue_put(struct tcp_queue_head* queue_head, const uint8_t* data, u
     while(data_left--)
     {
         if(data_pos >= queue_head->end)
-            data_pos -= queue_head->end - (uint8_t*) (queue_head + 1);
-        else if(data_pos < (uint8_t*) (queue_head + 1))
-            data_pos += (uintptr_t) (queue_head + 1);
+            data_pos -= queue_head->end - queue_head->start;
+        else if(data_pos < queue_head->start)
+            data_pos += (uintptr_t) queue_head->start;
 
         *data_pos++ = *data++;
     }
@@ -428,9 +476,9 @@ uint16_t tcp_queue_peek(const struct tcp_queue_head* queue_head, uint8_t* buffer
     while(data_left--)
     {
         if(data_pos >= queue_head->end)
-            data_pos -= queue_head->end - (uint8_t*) (queue_head + 1);
-        else if(data_pos < (uint8_t*) (queue_head + 1))
-            data_pos += (uintptr_t) (queue_head + 1);
+            data_pos -= queue_head->end - queue_head->start;
+        else if(data_pos < queue_head->start)
+            data_pos += (uintptr_t) queue_head->start;
 
         *buffer++ = *data_pos++;
     }
@@ -461,9 +509,9 @@ uint16_t tcp_queue_skip(struct tcp_queue_head* queue_head, uint16_t len)
     queue_head->used -= len;
     queue_head->pos += len;
     if(queue_head->pos >= queue_head->end)
-        queue_head->pos -= queue_head->end - (uint8_t*) (queue_head + 1);
-    else if(queue_head->pos < (uint8_t*) (queue_head + 1))
-        queue_head->pos += (uintptr_t) (queue_head + 1);
+        queue_head->pos -= queue_head->end - queue_head->start;
+    else if(queue_head->pos < queue_head->start)
+        queue_head->pos += (uintptr_t) queue_head->start;
 
     return len;
 }
@@ -512,7 +560,7 @@ uint8_t* tcp_queue_used_buffer(struct tcp_queue_head* queue_head)
         return 0;
 
     /* rotate data until it is linear and contiguous */
-    uint8_t* buffer = (uint8_t*) (queue_head + 1);
+    uint8_t* buffer = queue_head->start;
     uint16_t space = tcp_queue_space(queue_head);
     if(space >= 32)
     {
@@ -585,26 +633,26 @@ uint8_t* tcp_queue_space_buffer(struct tcp_queue_head* queue_head)
         return 0;
 
     if(queue_head->used < 1)
-        queue_head->pos = (uint8_t*) (queue_head + 1);
+        queue_head->pos = queue_head->start;
 
-    if(queue_head->pos == (uint8_t*) (queue_head + 1))
+    if(queue_head->pos == queue_head->start)
     {
         return queue_head->pos + queue_head->used;
     }
     else if(queue_head->pos + queue_head->used == queue_head->end)
     {
-        return (uint8_t*) (queue_head + 1);
+        return queue_head->start;
     }
     else if(queue_head->used < queue_head->end - queue_head->pos)
     {
         /* rearrange memory */
         uint8_t* from = queue_head->pos;
-        uint8_t* to = (uint8_t*) (queue_head + 1);
+        uint8_t* to = queue_head->start;
         uint16_t used = queue_head->used;
 
         while(used-- > 0)
             *to++ = *from++;
-        queue_head->pos = (uint8_t*) (queue_head + 1);
+        queue_head->pos = queue_head->start;
 
         return queue_head->pos + queue_head->used;
     }
@@ -639,7 +687,90 @@ uint16_t tcp_queue_space(const struct tcp_queue_head* queue_head)
     if(!queue_head)
         return 0;
 
-    return queue_head->end - (uint8_t*) (queue_head + 1) - queue_head->used;
+    return queue_head->end - queue_head->start - queue_head->used;
+}
+
+/**
+ * Assigns a run of contiguous pool blocks to a ring buffer.
+ *
+ * \param[in] queue_head A pointer to the ring buffer header.
+ * \param[in] blocks The number of blocks the ring buffer should get.
+ * \returns \c true on success, \c false if no such run is unused.
+ */
+bool tcp_queue_head_alloc(struct tcp_queue_head* queue_head, uint16_t blocks)
+{
+    if(blocks < 1 || blocks > tcp_queue_pool_free)
+        return false;
+
+    /* first fit */
+    uint16_t run = 0;
+    for(uint16_t block = 0; block < TCP_POOL_BLOCK_COUNT; ++block)
+    {
+        if(tcp_queue_pool_used[block / 8] & (1 << (block % 8)))
+        {
+            run = 0;
+            continue;
+        }
+
+        if(++run < blocks)
+            continue;
+
+        block -= blocks - 1;
+        tcp_queue_pool_mark(block, blocks, true);
+
+        queue_head->start = tcp_queue_pool[block];
+        queue_head->pos = queue_head->start;
+        queue_head->end = queue_head->start + blocks * TCP_POOL_BLOCK_SIZE;
+        queue_head->used = 0;
+
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Returns the blocks of a ring buffer to the pool.
+ *
+ * \param[in] queue_head A pointer to the ring buffer header.
+ */
+void tcp_queue_head_free(struct tcp_queue_head* queue_head)
+{
+    if(!queue_head->start)
+        return;
+
+    tcp_queue_pool_mark((queue_head->start - tcp_queue_pool[0]) / TCP_POOL_BLOCK_SIZE,
+                        (queue_head->end - queue_head->start) / TCP_POOL_BLOCK_SIZE,
+                        false
+                       );
+
+    queue_head->start = 0;
+    queue_head->pos = 0;
+    queue_head->end = 0;
+    queue_head->used = 0;
+}
+
+/**
+ * Marks a run of pool blocks as used or unused.
+ *
+ * \param[in] block The index of the first block.
+ * \param[in] count The number of blocks.
+ * \param[in] used \c true to mark the blocks as used, \c false to mark them unused.
+ */
+void tcp_queue_pool_mark(uint16_t block, uint16_t count, bool used)
+{
+    if(used)
+        tcp_queue_pool_free -= count;
+    else
+        tcp_queue_pool_free += count;
+
+    for(; count > 0; --count, ++block)
+    {
+        if(used)
+            tcp_queue_pool_used[block / 8] |= 1 << (block % 8);
+        else
+            tcp_queue_pool_used[block / 8] &= ~(1 << (block % 8));
+    }
 }
 
 /**
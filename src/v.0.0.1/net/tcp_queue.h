@@ -37,8 +37,9 @@
 
 struct tcp_queue;
 
-struct tcp_queue* tcp_queue_alloc();
+struct tcp_queue* tcp_queue_alloc(uint8_t reserved);
 void tcp_queue_free(struct tcp_queue* queue);
+uint16_t tcp_queue_pool_space();
 
 uint16_t tcp_queue_put_rx(struct tcp_queue* queue, const uint8_t* data, uint16_t data_len);
 uint16_t tcp_queue_get_rx(struct tcp_queue* queue, uint8_t* buffer, uint16_t buffer_len);
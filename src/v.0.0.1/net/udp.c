@@ -7,8 +7,10 @@
  * published by the Free Software Foundation.
  */
 
+#include "hal.h"
 #include "ip.h"
 #include "net.h"
+#include "net_stats.h"
 #include "udp.h"
 
 #include <string.h>
@@ -55,6 +57,7 @@ struct udp_socket
     uint16_t port_local;
     uint16_t port_remote;
     uint8_t ip_remote[4];
+    uint8_t ip_group[4];
 };
 
 struct udp_header
@@ -74,7 +77,10 @@ static int udp_socket_number(const struct udp_socket* socket);
 
 static bool udp_port_is_used(uint16_t port);
 static uint16_t udp_port_find_unused();
-static uint16_t udp_calc_checksum(const uint8_t* ip_destination, const struct udp_header* packet, uint16_t packet_len);
+static uint16_t udp_calc_checksum(const uint8_t* ip_remote, const uint8_t* ip_local, const struct udp_header* packet, uint16_t packet_len);
+
+#define udp_group_is_set(socket) \
+    (((socket)->ip_group[0] | (socket)->ip_group[1] | (socket)->ip_group[2] | (socket)->ip_group[3]) != 0x00)
 
 /**
  * Initializes the UDP layer. This function has to be called once on startup.
@@ -91,15 +97,21 @@ void udp_init()
  *
  * \returns \c true if a matching socket was found, \c false if the packet was discarded.
  */
-bool udp_handle_packet(const uint8_t* ip_remote, const struct udp_header* packet, uint16_t packet_len)
+bool udp_handle_packet(const uint8_t* ip_remote, const uint8_t* ip_local, const struct udp_header* packet, uint16_t packet_len)
 {
     if(packet_len < sizeof(*packet))
         return false;
 
-    /* test checksum */
-    if(udp_calc_checksum(ip_remote, packet, packet_len) != ntoh16(packet->checksum))
+    /* test checksum, unless the network hardware already did or the sender did not calculate one */
+    if(!hal_checksum_verified() && packet->checksum != 0 &&
+       !net_checksum_equal(ntoh16(packet->checksum), udp_calc_checksum(ip_remote, ip_local, packet, packet_len)))
+    {
         /* invalid checksum */
+        net_stats_inc(NET_STAT_UDP_RX_CHECKSUM);
         return false;
+    }
+
+    net_stats_inc(NET_STAT_UDP_RX);
 
     /* check for valid port numbers */
     uint16_t packet_port_local = ntoh16(packet->port_destination);
@@ -119,14 +131,22 @@ bool udp_handle_packet(const uint8_t* ip_remote, const struct udp_header* packet
            memcmp(socket->ip_remote, ip_remote, sizeof(socket->ip_remote)) != 0
           )
             continue;
+        /* group traffic only reaches the members of that group, and members only get their group's */
+        if(udp_group_is_set(socket) ? memcmp(socket->ip_group, ip_local, sizeof(socket->ip_group)) != 0
+                                    : (ip_local[0] & 0xf0) == 0xe0
+          )
+            continue;
 
         int socket_number = udp_socket_number(socket);
 
-        udp_bind_remote(socket_number, ip_remote, packet_port_remote);
-        socket->callback(socket_number, (uint8_t*) (packet + 1), packet_len);
+        /* a group member keeps listening to all senders */
+        if(!udp_group_is_set(socket))
+            udp_bind_remote(socket_number, ip_remote, packet_port_remote);
+        socket->callback(socket_number, (uint8_t*) (packet + 1), packet_len - sizeof(*packet));
         return true;
     }
 
+    net_stats_inc(NET_STAT_UDP_RX_NO_SOCKET);
     return false;
 }
 
@@ -264,6 +284,64 @@ bool udp_unbind_remote(int socket)
     return true;
 }
 
+/**
+ * Makes a socket receive the packets sent to a multicast group.
+ *
+ * The socket gets the group's packets arriving at its local port, and only
+ * those. It is not bound to the first sender as usual, and sends to the group
+ * unless bound to a remote host via udp_bind_remote().
+ *
+ * \note No IGMP membership reports are sent, so switches doing IGMP snooping
+ *       have to flood the group.
+ *
+ * \param[in] socket The identifier of the socket which joins the group.
+ * \param[in] ip_group The multicast group address, 224.0.0.0 to 239.255.255.255.
+ * \returns \c true on success, \c false on failure.
+ */
+bool udp_join_group(int socket, const uint8_t* ip_group)
+{
+    if(!udp_socket_valid(socket) || !ip_group || (ip_group[0] & 0xf0) != 0xe0)
+        return false;
+
+    memcpy(udp_sockets[socket].ip_group, ip_group, sizeof(udp_sockets[socket].ip_group));
+    return true;
+}
+
+/**
+ * Stops a socket from receiving the packets of its multicast group.
+ *
+ * \param[in] socket The identifier of the socket which leaves its group.
+ * \returns \c true on success, \c false on failure.
+ */
+bool udp_leave_group(int socket)
+{
+    if(!udp_socket_valid(socket))
+        return false;
+
+    memset(udp_sockets[socket].ip_group, 0, sizeof(udp_sockets[socket].ip_group));
+    return true;
+}
+
+/**
+ * Checks if any socket joined a multicast group.
+ *
+ * \param[in] ip_group The multicast group address.
+ * \returns \c true if packets to the group should be received, \c false otherwise.
+ */
+bool udp_group_joined(const uint8_t* ip_group)
+{
+    struct udp_socket* socket;
+    FOREACH_SOCKET(socket)
+    {
+        if(socket->port_local != 0 &&
+           memcmp(socket->ip_group, ip_group, sizeof(socket->ip_group)) == 0
+          )
+            return true;
+    }
+
+    return false;
+}
+
 /**
  * Send an UDP packet from the transmit buffer to a remote host.
  *
@@ -275,6 +353,24 @@ bool udp_unbind_remote(int socket)
  * \returns \c true if the packet was successfully sent, \c false on failure.
  */
 bool udp_send(int socket, uint16_t data_len)
+{
+    return udp_send_data(socket, data_len, 0, 0);
+}
+
+/**
+ * Send an UDP packet whose payload starts in the transmit buffer and continues in a separate buffer.
+ *
+ * The first \c header_len payload bytes are read from udp_get_buffer(), the
+ * remaining \c data_len bytes straight from \c data, which saves copying
+ * them into the transmit buffer. Everything else is like udp_send().
+ *
+ * \param[in] socket The identifier of the socket via which to send the packet.
+ * \param[in] header_len The length of the payload part in the transmit buffer.
+ * \param[in] data A pointer to the rest of the payload.
+ * \param[in] data_len The length of the rest of the payload.
+ * \returns \c true if the packet was successfully sent, \c false on failure.
+ */
+bool udp_send_data(int socket, uint16_t header_len, const uint8_t* data, uint16_t data_len)
 {
     if(!udp_socket_valid(socket))
         return -1;
@@ -286,29 +382,54 @@ bool udp_send(int socket, uint16_t data_len)
     if(sck->port_remote < 1)
         return -1;
 
-    /* check if we send a broadcast */
+    /* check if we send to our group or a broadcast */
     const uint8_t* ip_remote = sck->ip_remote;
     if((ip_remote[0] | ip_remote[1] | ip_remote[2] | ip_remote[3]) == 0x00)
-        ip_remote = ip_get_broadcast();
+        ip_remote = udp_group_is_set(sck) ? sck->ip_group : ip_get_broadcast();
 
     /* check maximum packet size */
     struct udp_header* header = (struct udp_header*) ip_get_buffer();
     uint16_t packet_data_max = ip_get_buffer_size() - sizeof(*header);
-    if(data_len > packet_data_max)
-        data_len = packet_data_max;
+    if(header_len > packet_data_max)
+        header_len = packet_data_max;
+    if(data_len > packet_data_max - header_len)
+        data_len = packet_data_max - header_len;
 
     /* prepare udp header */
+    uint16_t packet_len = sizeof(*header) + header_len + data_len;
     memset(header, 0, sizeof(*header));
     header->port_source = hton16(sck->port_local);
     header->port_destination = hton16(sck->port_remote);
-    header->length = hton16(sizeof(*header) + data_len);
-    header->checksum = hton16(udp_calc_checksum(ip_remote, header, sizeof(*header) + data_len));
-    
+    header->length = hton16(packet_len);
+#ifdef HAL_CHECKSUM_OFFLOAD
+    header->checksum = hton16(ip_calc_pseudo_checksum(ip_remote, IP_PROTOCOL_UDP, packet_len));
+#else
+    uint16_t checksum = ip_calc_pseudo_checksum(ip_remote, IP_PROTOCOL_UDP, packet_len);
+    checksum = net_calc_checksum(checksum, (uint8_t*) header, sizeof(*header) + header_len, 6);
+    if(data_len > 0)
+    {
+        /* the data sum has to be byte-swapped when it starts at an odd offset */
+        uint16_t checksum_data = net_calc_checksum(0, data, data_len, 1);
+        if(header_len & 1)
+            checksum_data = checksum_data << 8 | checksum_data >> 8;
+        checksum += checksum_data;
+        if(checksum < checksum_data)
+            ++checksum;
+    }
+    /* a zero checksum means "none" in UDP, so it is sent as its other representation */
+    checksum = ~checksum;
+    header->checksum = checksum ? hton16(checksum) : 0xffff;
+#endif
+
+    net_stats_inc(NET_STAT_UDP_TX);
+
     /* send packet via the ip layer */
-    return ip_send_packet(ip_remote,
-                          IP_PROTOCOL_UDP,
-                          sizeof(*header) + data_len
-                         );
+    return ip_send_packet_data(ip_remote,
+                               IP_PROTOCOL_UDP,
+                               sizeof(*header) + header_len,
+                               data,
+                               data_len
+                              );
 }
 
 /**
@@ -322,7 +443,7 @@ int udp_socket_number(const struct udp_socket* socket)
     if(!socket)
         return -1;
 
-    int sck = ((int) socket - (int) &udp_sockets[0]) / sizeof(*socket);
+    int sck = socket - &udp_sockets[0];
     if(!udp_socket_valid(sck))
         return -1;
 
@@ -374,12 +495,12 @@ uint16_t udp_port_find_unused()
  *
  * \returns The 16-bit checksum.
  */
-uint16_t udp_calc_checksum(const uint8_t* ip_destination, const struct udp_header* packet, uint16_t packet_len)
+uint16_t udp_calc_checksum(const uint8_t* ip_remote, const uint8_t* ip_local, const struct udp_header* packet, uint16_t packet_len)
 {
-    /* pseudo header */
+    /* pseudo header, with the address the packet was sent to, which may be a broadcast or group */
     uint16_t checksum = IP_PROTOCOL_UDP + packet_len;
-    checksum = net_calc_checksum(checksum, ip_get_address(), 4, 4);
-    checksum = net_calc_checksum(checksum, ip_destination, 4, 4);
+    checksum = net_calc_checksum(checksum, ip_local, 4, 4);
+    checksum = net_calc_checksum(checksum, ip_remote, 4, 4);
 
     /* real package */
     return ~net_calc_checksum(checksum, (uint8_t*) packet, packet_len, 6);
@@ -45,7 +45,7 @@ typedef void (*udp_callback)(int socket, uint8_t* data, uint16_t data_len);
 
 void udp_init();
 
-bool udp_handle_packet(const uint8_t* ip_remote, const struct udp_header* packet, uint16_t packet_len);
+bool udp_handle_packet(const uint8_t* ip_remote, const uint8_t* ip_local, const struct udp_header* packet, uint16_t packet_len);
 
 int udp_socket_alloc(udp_callback callback);
 bool udp_socket_free(int socket);
@@ -54,7 +54,12 @@ bool udp_bind_local(int socket, uint16_t port_local);
 bool udp_bind_remote(int socket, const uint8_t* ip_remote, uint16_t port_remote);
 bool udp_unbind_remote(int socket);
 
+bool udp_join_group(int socket, const uint8_t* ip_group);
+bool udp_leave_group(int socket);
+bool udp_group_joined(const uint8_t* ip_group);
+
 bool udp_send(int socket, uint16_t data_len);
+bool udp_send_data(int socket, uint16_t header_len, const uint8_t* data, uint16_t data_len);
 
 /**
  * Checks if the given number is a valid socket identifier.
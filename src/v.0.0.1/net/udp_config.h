@@ -43,7 +43,7 @@
 /**
  * The maximum number of UDP sockets allocated in parallel.
  */
-#define UDP_MAX_SOCKET_COUNT 2
+#define UDP_MAX_SOCKET_COUNT 6
 
 /**
  * The maximum segment size of outgoing UDP packets.
@@ -41,6 +41,7 @@ void pid_Init(int32_t p_factor, int32_t i_factor, int32_t d_factor, pidData_t *p
 	// Start values for PID controller
 	pid->sumError = 0;
 	pid->lastProcessValue = 0;
+	pid->lastPTerm = pid->lastITerm = pid->lastDTerm = 0;
 	// Tuning constants for PID loop
 	pid->P_Factor = p_factor;
 	pid->I_Factor = i_factor;
@@ -101,6 +102,10 @@ int32_t pid_Controller(int32_t setPoint, int32_t processValue, pidData_t *pid_st
 
 	pid_st->lastProcessValue = processValue;
 
+	pid_st->lastPTerm = p_term;
+	pid_st->lastITerm = i_term;
+	pid_st->lastDTerm = d_term;
+
 	ret = ( p_term + i_term + d_term ) / SCALING_FACTOR;
 
 	if( ret > MAX_INT ) {
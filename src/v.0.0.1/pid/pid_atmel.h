@@ -41,6 +41,10 @@ typedef struct {
 	int32_t maxError;
 	//! Maximum allowed sumerror, avoid overflow
 	int32_t maxSumError;
+	//! Terms of the last output, multiplied with SCALING_FACTOR
+	int32_t lastPTerm;
+	int32_t lastITerm;
+	int32_t lastDTerm;
 } pidData_t;
 
 /*! \brief Maximum values
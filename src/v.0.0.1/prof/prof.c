@@ -0,0 +1,120 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "../main.h"
+#include "prof.h"
+
+typedef struct {
+	uint16_t min;		// timebase ticks
+	uint16_t max;
+	uint32_t sum;
+} PROF_ACC;
+
+static PROF_ACC profAcc[NUMBER_OF_PROF_STAGE];
+static PROF_STAGE profResult[NUMBER_OF_PROF_STAGE];
+
+static uint16_t profMarkTime;
+static uint16_t profLoops;
+static uint16_t profLoopRate;
+
+static const char profName0[] PROGMEM = "config";
+static const char profName1[] PROGMEM = "adc";
+static const char profName2[] PROGMEM = "dio";
+static const char profName3[] PROGMEM = "sd";
+static const char profName4[] PROGMEM = "ethernet";
+static const char profName5[] PROGMEM = "timer";
+static const char profName6[] PROGMEM = "modbus";
+static const char profName7[] PROGMEM = "pid";
+static const char profName8[] PROGMEM = "dac";
+
+static PGM_P const profStageName[NUMBER_OF_PROF_STAGE] PROGMEM = {
+	profName0, profName1, profName2, profName3, profName4,
+	profName5, profName6, profName7, profName8
+};
+
+static void profReset(void)
+{
+	uint8_t i;
+
+	for( i = 0; i < NUMBER_OF_PROF_STAGE; i++ ) {
+		profAcc[i].min = 0xffff;
+		profAcc[i].max = 0;
+		profAcc[i].sum = 0;
+	}
+
+	profLoops = 0;
+}
+
+void profInit(void)
+{
+	memset( profResult, 0, sizeof(profResult) );
+	profLoopRate = 0;
+
+	profReset();
+	profMarkTime = timebase_now();
+}
+
+// Charges the time since the previous mark to 'stage':
+void profMark(uint8_t stage)
+{
+	uint16_t now = timebase_now();
+	uint16_t dt = now - profMarkTime;
+	PROF_ACC *lpAcc = &profAcc[stage];
+
+	profMarkTime = now;
+
+	if( dt < lpAcc->min ) lpAcc->min = dt;
+	if( dt > lpAcc->max ) lpAcc->max = dt;
+	lpAcc->sum += dt;
+
+	if( NUMBER_OF_PROF_STAGE - 1 == stage && profLoops < 0xffff ) {
+		++profLoops;
+	}
+}
+
+// Latches the window since the previous call, called once a second:
+void profUpdate(void)
+{
+	uint8_t i;
+
+	profLoopRate = profLoops;
+
+	for( i = 0; i < NUMBER_OF_PROF_STAGE; i++ ) {
+		if( !profLoops ) {
+			memset( &profResult[i], 0, sizeof(*profResult) );
+			continue;
+		}
+
+		profResult[i].min = profAcc[i].min / TIMEBASE_TICKS_PER_US;
+		profResult[i].avg = profAcc[i].sum / profLoops / TIMEBASE_TICKS_PER_US;
+		profResult[i].max = profAcc[i].max / TIMEBASE_TICKS_PER_US;
+	}
+
+	profReset();
+}
+
+void profGetStage(uint8_t stage, LP_PROF_STAGE lpStage)
+{
+	if( stage < NUMBER_OF_PROF_STAGE ) {
+		*lpStage = profResult[stage];
+	}
+}
+
+uint16_t profGetLoopRate(void)
+{
+	return profLoopRate;
+}
+
+PGM_P profGetStageName(uint8_t stage)
+{
+	if( stage >= NUMBER_OF_PROF_STAGE ) {
+		return 0;
+	}
+
+	return (PGM_P)pgm_read_word( &profStageName[stage] );
+}
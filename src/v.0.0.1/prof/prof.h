@@ -0,0 +1,51 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef __PROF_H__
+#define __PROF_H__
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Stages of the main loop, in the order they are run:
+#define PROF_STAGE_CONFIG				0	// analog control word, EEPROM
+#define PROF_STAGE_ADC					1
+#define PROF_STAGE_DIGITAL_IO			2	// digital inputs, address switch
+#define PROF_STAGE_SD					3	// SD card hot-plug, link and Modbus mode changes
+#define PROF_STAGE_ETHERNET				4	// ethernet_handle_packet(), telemetry datagrams
+#define PROF_STAGE_TIMER				5	// timer_interval()
+#define PROF_STAGE_MODBUS				6	// encoder snapshot, eMBPoll()
+#define PROF_STAGE_PID					7	// servo diagnostics, the loop itself runs in servoTick()
+#define PROF_STAGE_DAC					8	// DAC set points, digital outputs
+#define NUMBER_OF_PROF_STAGE			9
+
+typedef struct {
+	uint16_t min;		// us
+	uint16_t avg;		// us
+	uint16_t max;		// us
+} PROF_STAGE, *LP_PROF_STAGE;
+
+/*
+	Stage times are measured with the timebase (arch/timebase.h) between two
+	profMark() calls, so they include the interrupts served meanwhile. A stage
+	longer than one timebase period (32 ms) wraps.
+
+	The background services (sched_run()) mark their stage after every step,
+	so their min/max are per step, while avg is per main loop pass.
+
+	profUpdate() closes the measurement window, it is called once a second.
+*/
+void profInit(void);
+void profMark(uint8_t stage);
+void profUpdate(void);
+
+void profGetStage(uint8_t stage, LP_PROF_STAGE lpStage);
+uint16_t profGetLoopRate(void);
+PGM_P profGetStageName(uint8_t stage);
+
+#endif
@@ -155,6 +155,8 @@ static uint8_t raw_block_written;
 #endif
 
 /* private helper functions */
+static void sd_raw_select();
+static void sd_raw_unselect();
 static uint8_t sd_raw_send_command_r1(uint8_t command, uint32_t arg);
 //static uint16_t sd_raw_send_command_r2(uint8_t command, uint32_t arg);
 
@@ -187,24 +189,23 @@ uint8_t sd_raw_init()
 	spi_low_frequency();
 
 	/* card needs 74 cycles minimum to start up */
+	spi_bus_lock();
 	for(uint8_t i = 0; i < 32; ++i) {
 		/* wait 8 clock cycles */
 		spi_rec_byte();
 	}
+	spi_bus_unlock();
 	
-	/* address card */
-	select_card();
-	
-	/* reset card */
+	/* reset card, one command per transaction at the low frequency */
 	uint8_t response;
 	for(uint16_t i = 0; ; ++i) {
+		sd_raw_select();
 		response = sd_raw_send_command_r1(CMD_GO_IDLE_STATE, 0);
+		sd_raw_unselect();
 		if(response == (1 << R1_IDLE_STATE))
 			break;
 		
 		if(i == 0x1ff) {
-			unselect_card();
-			spi_rec_byte();
 			spi_high_frequency();
 			return 0;
 		}
@@ -212,30 +213,27 @@ uint8_t sd_raw_init()
 	
 	/* wait for card to get ready */
 	for(uint16_t i = 0; ; ++i) {
+		sd_raw_select();
 		response = sd_raw_send_command_r1(CMD_SEND_OP_COND, 0);
+		sd_raw_unselect();
 		if(!(response & (1 << R1_IDLE_STATE)))
 			break;
 		
 		if(i == 0x7fff) {
-			unselect_card();
-			spi_rec_byte();
 			spi_high_frequency();
 			return 0;
 		}
 	}
 	
 	/* set block size to 512 bytes */
-	if(sd_raw_send_command_r1(CMD_SET_BLOCKLEN, 512)) {
-		unselect_card();
-		spi_rec_byte();
+	sd_raw_select();
+	response = sd_raw_send_command_r1(CMD_SET_BLOCKLEN, 512);
+	sd_raw_unselect();
+	if(response) {
 		spi_high_frequency();
 		return 0;
 	}
 	
-	/* deaddress card */
-	unselect_card();
-	spi_rec_byte();
-	
 	/* switch to highest SPI frequency possible */
 	spi_high_frequency();
 	
@@ -274,6 +272,30 @@ uint8_t sd_raw_locked()
 	return get_pin_locked() == 0x00;
 }
 
+/**
+ * \ingroup sd_raw
+ * Claims the SPI bus and addresses the card for one transaction.
+ *
+ * The bus is given back after every command or data block, so the
+ * jobs of the other devices run between two transactions.
+ */
+void sd_raw_select()
+{
+	spi_bus_lock();
+	select_card();
+}
+
+/**
+ * \ingroup sd_raw
+ * Deaddresses the card and releases the SPI bus.
+ */
+void sd_raw_unselect()
+{
+	unselect_card();
+	spi_rec_byte();
+	spi_bus_unlock();
+}
+
 /**
  * \ingroup sd_raw
  * Send a command to the memory card which responses with a R1 response.
@@ -379,17 +401,19 @@ uint8_t sd_raw_read(uint32_t offset, uint8_t* buffer, uint16_t length)
 #endif
 
 			/* address card */
-			select_card();
+			sd_raw_select();
 
 			/* send single block request */
 			if(sd_raw_send_command_r1(CMD_READ_SINGLE_BLOCK, block_address))
 			{
-				unselect_card();
-				spi_rec_byte();
+				sd_raw_unselect();
 				return 0;
 			}
 
-			/* wait for data block (start byte 0xfe) */
+			/* Wait for data block (start byte 0xfe). The card stays
+			 * selected and the bus locked up to the CRC of the block,
+			 * this wait being the bulk of the worst case hold time.
+			 */
 			uint16_t i;
 			for( i = 0; i < 0x1fff; ++i ) {
 				if(spi_rec_byte() == 0xfe) {
@@ -397,8 +421,7 @@ uint8_t sd_raw_read(uint32_t offset, uint8_t* buffer, uint16_t length)
 				}
 			}
 			if( i >= 0x1fff ) {
-				unselect_card();
-				spi_rec_byte();
+				sd_raw_unselect();
 				return 0;
 			}
 
@@ -425,8 +448,7 @@ uint8_t sd_raw_read(uint32_t offset, uint8_t* buffer, uint16_t length)
 			spi_rec_byte();
 			
 			/* deaddress card */
-			unselect_card();
-			spi_rec_byte();
+			sd_raw_unselect();
 		}
 #if !SD_RAW_SAVE_RAM
 		else
@@ -491,9 +513,6 @@ uint8_t sd_raw_read_interval(uint32_t offset, uint8_t* buffer, uint16_t interval
 
 	return 1;
 #else
-	/* address card */
-	select_card();
-
 	uint16_t block_offset;
 	uint16_t read_length;
 	uint8_t* buffer_cur;
@@ -504,11 +523,13 @@ uint8_t sd_raw_read_interval(uint32_t offset, uint8_t* buffer, uint16_t interval
 		block_offset = offset & 0x01ff;
 		read_length = 512 - block_offset;
 		
+		/* address card, one block per transaction */
+		sd_raw_select();
+
 		/* send single block request */
 		if(sd_raw_send_command_r1(CMD_READ_SINGLE_BLOCK, offset & 0xfffffe00))
 		{
-			unselect_card();
-			spi_rec_byte();
+			sd_raw_unselect();
 			return 0;
 		}
 
@@ -521,8 +542,7 @@ uint8_t sd_raw_read_interval(uint32_t offset, uint8_t* buffer, uint16_t interval
 		}
 		if(i >= 0x1fff)
 		{
-			unselect_card();
-			spi_rec_byte();
+			sd_raw_unselect();
 			return 0;
 		}
 
@@ -557,16 +577,15 @@ uint8_t sd_raw_read_interval(uint32_t offset, uint8_t* buffer, uint16_t interval
 		spi_rec_byte();
 		spi_rec_byte();
 
+		/* deaddress card */
+		sd_raw_unselect();
+
 		if(length < interval)
 			break;
 
 		offset = (offset & 0xfffffe00) + 512;
 
 	} while(!finished);
-	
-	/* deaddress card */
-	unselect_card();
-	spi_rec_byte();
 
 	return 1;
 #endif
@@ -635,13 +654,12 @@ uint8_t sd_raw_write(uint32_t offset, const uint8_t* buffer, uint16_t length)
 		}
 
 		/* address card */
-		select_card();
+		sd_raw_select();
 
 		/* send single block request */
 		if(sd_raw_send_command_r1(CMD_WRITE_SINGLE_BLOCK, block_address))
 		{
-			unselect_card();
-			spi_rec_byte();
+			sd_raw_unselect();
 			return 0;
 		}
 
@@ -655,23 +673,26 @@ uint8_t sd_raw_write(uint32_t offset, const uint8_t* buffer, uint16_t length)
 		spi_send_byte(0xff);
 		spi_send_byte(0xff);
 
-		/* wait while card is busy */
+		/* wait while card is busy, it keeps programming
+		 * while deselected, so give the bus back between polls
+		 */
 		uint16_t i;
 		for(i = 0; i < 0x7fff; ++i)
 		{
 			if(spi_rec_byte() == 0xff)
 				break;
+
+			sd_raw_unselect();
+			sd_raw_select();
 		}
 		if(i >= 0x7fff)
 		{
-			unselect_card();
-			spi_rec_byte();
+			sd_raw_unselect();
 			return 0;
 		}
 
 		/* deaddress card */
-		unselect_card();
-		spi_rec_byte();
+		sd_raw_unselect();
 
 		buffer += write_length;
 		offset += write_length;
@@ -794,13 +815,12 @@ uint8_t sd_raw_get_info(struct sd_raw_info* info)
 
 	memset(info, 0, sizeof(*info));
 
-	select_card();
+	sd_raw_select();
 
 	/* read cid register */
 	if(sd_raw_send_command_r1(CMD_SEND_CID, 0))
 	{
-		unselect_card();
-		spi_rec_byte();
+		sd_raw_unselect();
 		return 0;
 	}
 
@@ -812,8 +832,7 @@ uint8_t sd_raw_get_info(struct sd_raw_info* info)
 	}
 	if(i >= 0x1fff)
 	{
-		unselect_card();
-		spi_rec_byte();
+		sd_raw_unselect();
 		return 0;
 	}
 
@@ -862,8 +881,7 @@ uint8_t sd_raw_get_info(struct sd_raw_info* info)
 	uint16_t csd_c_size = 0;
 	if(sd_raw_send_command_r1(CMD_SEND_CSD, 0))
 	{
-		unselect_card();
-		spi_rec_byte();
+		sd_raw_unselect();
 		return 0;
 	}
 
@@ -874,8 +892,7 @@ uint8_t sd_raw_get_info(struct sd_raw_info* info)
 	}
 	if(i >= 0x1fff)
 	{
-		unselect_card();
-		spi_rec_byte();
+		sd_raw_unselect();
 		return 0;
 	}
 
@@ -920,8 +937,7 @@ uint8_t sd_raw_get_info(struct sd_raw_info* info)
 		}
 	}
 
-	unselect_card();
-	spi_rec_byte();
+	sd_raw_unselect();
 
 	return 1;
 }
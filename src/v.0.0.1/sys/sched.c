@@ -0,0 +1,148 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "sched.h"
+#include "sched_config.h"
+#include "../arch/timebase.h"
+
+#include <stdint.h>
+
+/**
+ * \addtogroup sys
+ *
+ * @{
+ */
+/**
+ * \addtogroup sys_sched Cooperative scheduler
+ *
+ * This module runs the background services of the main loop.
+ *
+ * Each task is a callback doing one bounded step of work. Tasks have a
+ * priority, \c 0 being the highest, and a time budget per main loop pass.
+ * The scheduler always runs the highest priority task with pending work
+ * and budget left. After every step of a task all tasks of higher priority
+ * are polled again, so e.g. a long transfer yields to them at every step.
+ *
+ * The budget is only checked between steps, a step which exceeds it runs
+ * to completion but ends the task's share of the pass.
+ *
+ * @{
+ */
+/**
+ * \file
+ * Scheduler implementation
+ */
+
+#define SCHED_FLAG_PENDING 1
+
+struct sched_task
+{
+	sched_callback callback;
+	uint8_t priority;
+	uint8_t flags;
+	uint16_t budget;
+	uint16_t left;
+};
+
+/* sorted by priority, equal priorities in the order of registration */
+static struct sched_task sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_task_count;
+
+/**
+ * Registers a task.
+ *
+ * \param[in] callback The function doing one step of the task.
+ * \param[in] priority The priority of the task, \c 0 is the highest.
+ * \param[in] budget_us The time in microseconds the task may use per main loop pass.
+ * \returns A non-negative task number on success, \c -1 on failure.
+ */
+int sched_task_add(sched_callback callback, uint8_t priority, uint16_t budget_us)
+{
+	struct sched_task* task;
+	uint32_t budget;
+
+	if(!callback || sched_task_count >= SCHED_MAX_TASKS) {
+		return -1;
+	}
+
+	budget = (uint32_t) budget_us * TIMEBASE_TICKS_PER_US;
+	if(budget > 0x7fff) {
+		/* keep it measurable within one timebase period */
+		budget = 0x7fff;
+	} else if(!budget) {
+		/* one step per pass */
+		budget = 1;
+	}
+
+	task = &sched_tasks[sched_task_count];
+	while(task > &sched_tasks[0] && task[-1].priority > priority) {
+		task[0] = task[-1];
+		--task;
+	}
+
+	task->callback = callback;
+	task->priority = priority;
+	task->flags = 0;
+	task->budget = budget;
+	task->left = 0;
+
+	++sched_task_count;
+
+	return task - &sched_tasks[0];
+}
+
+/**
+ * Runs one pass over all tasks.
+ *
+ * Every task is polled at least once. The pass ends when no task has
+ * pending work and budget left.
+ */
+void sched_run()
+{
+	struct sched_task* task;
+	struct sched_task* higher;
+	uint16_t start;
+	uint16_t elapsed;
+	bool more;
+
+	for(task = &sched_tasks[0]; task < &sched_tasks[sched_task_count]; ++task) {
+		task->flags |= SCHED_FLAG_PENDING;
+		task->left = task->budget;
+	}
+
+	for(;;) {
+		for(task = &sched_tasks[0]; task < &sched_tasks[sched_task_count]; ++task) {
+			if((task->flags & SCHED_FLAG_PENDING) && task->left) {
+				break;
+			}
+		}
+
+		if(task >= &sched_tasks[sched_task_count]) {
+			break;
+		}
+
+		start = timebase_now();
+		more = task->callback();
+		elapsed = timebase_now() - start;
+
+		task->left = elapsed < task->left ? task->left - elapsed : 0;
+		if(!more) {
+			task->flags &= ~SCHED_FLAG_PENDING;
+		}
+
+		for(higher = &sched_tasks[0]; higher < task && higher->priority < task->priority; ++higher) {
+			higher->flags |= SCHED_FLAG_PENDING;
+		}
+	}
+}
+
+/**
+ * @}
+ * @}
+ */
+
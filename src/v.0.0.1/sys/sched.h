@@ -0,0 +1,51 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sched_config.h"
+
+/**
+ * \addtogroup sys
+ *
+ * @{
+ */
+/**
+ * \addtogroup sys_sched
+ *
+ * @{
+ */
+/**
+ * \file
+ * Scheduler header
+ */
+
+/**
+ * The type of a task step.
+ *
+ * A step does a bounded amount of work, e.g. one packet or one timer
+ * tick, and runs to completion.
+ *
+ * \returns \c true if the task has more work pending, \c false otherwise.
+ */
+typedef bool (*sched_callback)();
+
+int sched_task_add(sched_callback callback, uint8_t priority, uint16_t budget_us);
+void sched_run();
+
+/**
+ * @}
+ * @}
+ */
+
+#endif
+
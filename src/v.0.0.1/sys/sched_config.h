@@ -0,0 +1,45 @@
+
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef SCHED_CONFIG_H
+#define SCHED_CONFIG_H
+
+/**
+ * \addtogroup sys
+ *
+ * @{
+ */
+/**
+ * \addtogroup sys_sched
+ *
+ * @{
+ */
+/**
+ * \addtogroup sys_sched_config Scheduler configuration
+ *
+ * @{
+ */
+/**
+ * \file
+ * Scheduler configuration
+ */
+
+/**
+ * The maximum number of tasks registered in parallel.
+ */
+#define SCHED_MAX_TASKS 6
+
+/**
+ * @}
+ * @}
+ * @}
+ */
+
+#endif
+
@@ -24,6 +24,10 @@
  *
  * This module provides timeout callbacks.
  *
+ * Running timers are kept in a hashed timing wheel. Each slot holds a
+ * list of the timers whose expiry tick maps to it, so a tick only costs
+ * the timers of one slot instead of all of them.
+ *
  * @{
  */
 /**
@@ -35,17 +39,26 @@
 
 #define TIMER_FLAG_STOPPED 1
 
+#if TIMER_WHEEL_SIZE & (TIMER_WHEEL_SIZE - 1)
+#error "TIMER_WHEEL_SIZE must be a power of two"
+#endif
+
 struct timer_descriptor
 {
 	uint8_t flags;
 	uint32_t next;
 	uintptr_t user;
 	timer_callback callback;	
+	struct timer_descriptor* wheel_next;
+	struct timer_descriptor* wheel_prev;
 };
 
 static struct timer_descriptor timer_descriptors[TIMER_MAX_COUNT];
+static struct timer_descriptor* timer_wheel[TIMER_WHEEL_SIZE];
 static uint32_t timer_clock;
 
+#define timer_slot(tick) ((uint8_t) (tick) & (TIMER_WHEEL_SIZE - 1))
+
 #define FOREACH_TIMER(timer)								\
 	for( (timer) = &timer_descriptors[0];					\
 		 (timer) < &timer_descriptors[TIMER_MAX_COUNT];		\
@@ -53,6 +66,8 @@ static uint32_t timer_clock;
 	)
 
 static int timer_number(const struct timer_descriptor* timer);
+static void timer_link(struct timer_descriptor* timer);
+static void timer_unlink(struct timer_descriptor* timer);
 
 /**
  * Global timeout handling function.
@@ -73,18 +88,37 @@ void timer_interval()
 
 	++timer_clock;
 
-	FOREACH_TIMER(timer) {
-		if( !timer->callback || (TIMER_FLAG_STOPPED & timer->flags) ) {
-			continue;
+	/* callbacks may restart, stop or free any timer, so rescan after each one */
+	for(;;) {
+		for( timer = timer_wheel[timer_slot(timer_clock)]; timer; timer = timer->wheel_next ) {
+			if( timer->next == timer_clock ) {
+				break;
+			}
 		}
 
-		if( timer->next == timer_clock ) {
-			timer->flags |= TIMER_FLAG_STOPPED;
-			timer->callback(timer_number(timer));
+		if(!timer) {
+			break;
 		}
+
+		timer_unlink(timer);
+		timer->flags |= TIMER_FLAG_STOPPED;
+		timer->callback(timer_number(timer));
 	}
 }
 
+/**
+ * Retrieves the time elapsed since startup.
+ *
+ * The resolution is #TIMER_MS_PER_TICK, as the time advances with each
+ * call of timer_interval().
+ *
+ * \returns The number of milliseconds since startup.
+ */
+uint32_t timer_millis()
+{
+	return timer_clock * TIMER_MS_PER_TICK;
+}
+
 /**
  * Allocates a timer.
  *
@@ -132,6 +166,8 @@ void timer_free(int timer)
 		return;
 	}
 
+	timer_unlink(&timer_descriptors[timer]);
+	timer_descriptors[timer].flags |= TIMER_FLAG_STOPPED;
 	timer_descriptors[timer].callback = 0;
 }
 
@@ -159,9 +195,14 @@ bool timer_set(int timer, uint32_t millis)
 		return false;
 	}
 
-	t->next = timer_clock + (millis + TIMER_MS_PER_TICK - 1) / TIMER_MS_PER_TICK;
+	timer_unlink(t);
+
+	millis = (millis + TIMER_MS_PER_TICK - 1) / TIMER_MS_PER_TICK;
+	t->next = timer_clock + (millis ? millis : 1);
 	t->flags &= ~TIMER_FLAG_STOPPED;
 
+	timer_link(t);
+
 	return true;
 }
 
@@ -177,6 +218,7 @@ bool timer_stop(int timer)
 		return false;
 	}
 
+	timer_unlink(&timer_descriptors[timer]);
 	timer_descriptors[timer].flags |= TIMER_FLAG_STOPPED;
 	return true;
 }
@@ -262,7 +304,7 @@ int timer_number(const struct timer_descriptor* timer)
 		return -1;
 	}
 
-	t  = ((int) timer - (int) &timer_descriptors[0]) / sizeof(*timer);
+	t  = timer - &timer_descriptors[0];
 
 	if(!timer_valid(t)) {
 		return -1;
@@ -271,6 +313,48 @@ int timer_number(const struct timer_descriptor* timer)
 	return t;
 }
 
+/**
+ * Inserts a running timer into the wheel slot of its expiry tick.
+ *
+ * \param[in] timer The internal timer structure to insert.
+ */
+void timer_link(struct timer_descriptor* timer)
+{
+	struct timer_descriptor** slot = &timer_wheel[timer_slot(timer->next)];
+
+	timer->wheel_prev = 0;
+	timer->wheel_next = *slot;
+	if(*slot) {
+		(*slot)->wheel_prev = timer;
+	}
+	*slot = timer;
+}
+
+/**
+ * Removes a timer from its wheel slot, if it is running.
+ *
+ * \param[in] timer The internal timer structure to remove.
+ */
+void timer_unlink(struct timer_descriptor* timer)
+{
+	if(TIMER_FLAG_STOPPED & timer->flags) {
+		return;
+	}
+
+	if(timer->wheel_prev) {
+		timer->wheel_prev->wheel_next = timer->wheel_next;
+	} else {
+		timer_wheel[timer_slot(timer->next)] = timer->wheel_next;
+	}
+
+	if(timer->wheel_next) {
+		timer->wheel_next->wheel_prev = timer->wheel_prev;
+	}
+
+	timer->wheel_next = 0;
+	timer->wheel_prev = 0;
+}
+
 /**
  * @}
  * @}
@@ -38,6 +38,7 @@
 typedef void (*timer_callback)(int timer);
 
 void timer_interval();
+uint32_t timer_millis();
 
 int timer_alloc(timer_callback callback, uintptr_t user);
 void timer_free(int timer);
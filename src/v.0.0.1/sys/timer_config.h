@@ -34,8 +34,19 @@
 
 /**
  * The maximum number of timers allocated in parallel.
+ *
+ * Only allocation scans all of them, the per-tick cost depends
+ * on the timers hashed to the current wheel slot.
+ */
+#define TIMER_MAX_COUNT 12
+
+/**
+ * The number of slots of the timing wheel, must be a power of two.
+ *
+ * A timer is hashed to the slot of the tick it expires in, so
+ * timer_interval() only visits the timers of one slot per tick.
  */
-#define TIMER_MAX_COUNT 5
+#define TIMER_WHEEL_SIZE 16
 
 /**
  * The length of the time slices in milliseconds which should be assumed
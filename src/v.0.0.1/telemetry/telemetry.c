@@ -0,0 +1,154 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#include "../main.h"
+#include "telemetry.h"
+
+#define TELEMETRY_NONE					0xff
+
+static int telemetrySocket = -1;
+static uint32_t telemetryLeaseStart;
+static uint32_t telemetrySequence;
+
+// Written by the servo tick, the sender owns telemetryReady until it releases it:
+static TELEMETRY_SAMPLE telemetryBatch[2][TELEMETRY_SAMPLES];
+static volatile uint8_t telemetryFill;
+static volatile uint8_t telemetryCount;
+static volatile uint8_t telemetryReady;
+static volatile uint16_t telemetryDivider;
+static volatile uint16_t telemetryCountdown;
+static volatile uint16_t telemetryOverruns;
+
+static void telemetryIncoming(int socket, uint8_t* data, uint16_t data_len);
+static void telemetryStart(uint16_t divider);
+static void telemetryStop(void);
+
+void telemetryInit(void)
+{
+	telemetryDivider = 0;
+	telemetryReady = TELEMETRY_NONE;
+
+	telemetrySocket = udp_socket_alloc( telemetryIncoming );
+	if( udp_socket_valid( telemetrySocket ) ) {
+		udp_bind_local( telemetrySocket, TELEMETRY_PORT );
+	}
+}
+
+// Subscription requests, the UDP layer has already bound the socket to the sender:
+static void telemetryIncoming(int socket, uint8_t* data, uint16_t data_len)
+{
+	uint16_t divider = TELEMETRY_DEFAULT_DIVIDER;
+
+	if( data_len >= 2 ) {
+		divider = data[0] | (uint16_t)data[1]<<8;
+	}
+
+	if( !divider ) {
+		telemetryStop();
+		return;
+	}
+
+	// Renewing with the same divider keeps the stream going:
+	if( divider != telemetryDivider ) {
+		telemetryStart( divider );
+	}
+	telemetryLeaseStart = timer_millis();
+}
+
+static void telemetryStart(uint16_t divider)
+{
+	cli();
+	telemetryDivider = 0;
+	sei();
+
+	telemetryFill = 0;
+	telemetryCount = 0;
+	telemetryReady = TELEMETRY_NONE;
+	telemetryOverruns = 0;
+	telemetrySequence = 0;
+
+	cli();
+	telemetryCountdown = 1;
+	telemetryDivider = divider;
+	sei();
+}
+
+static void telemetryStop(void)
+{
+	cli();
+	telemetryDivider = 0;
+	sei();
+
+	udp_unbind_remote( telemetrySocket );
+}
+
+// Sends one completed batch per step:
+bool telemetryTask(void)
+{
+	uint8_t ready;
+	TELEMETRY_HEADER* lpHeader;
+
+	if( !telemetryDivider ) {
+		return false;
+	}
+
+	if( (uint32_t)(timer_millis() - telemetryLeaseStart) > TELEMETRY_LEASE_MS ) {
+		telemetryStop();
+		return false;
+	}
+
+	ready = telemetryReady;
+	if( TELEMETRY_NONE == ready ) {
+		return false;
+	}
+
+	lpHeader = (TELEMETRY_HEADER*)udp_get_buffer();
+	lpHeader->sequence = telemetrySequence++;
+	lpHeader->count = TELEMETRY_SAMPLES;
+	lpHeader->sampleSize = sizeof(TELEMETRY_SAMPLE);
+	lpHeader->divider = telemetryDivider;
+	lpHeader->overruns = telemetryOverruns;
+
+	// The samples go to the controller straight from the batch:
+	udp_send_data( telemetrySocket, sizeof(TELEMETRY_HEADER), (const uint8_t*)telemetryBatch[ready], sizeof(telemetryBatch[ready]) );
+
+	telemetryReady = TELEMETRY_NONE;
+	return false;
+}
+
+bool telemetryDue(void)
+{
+	if( !telemetryDivider ) {
+		return false;
+	}
+
+	if( --telemetryCountdown ) {
+		return false;
+	}
+	telemetryCountdown = telemetryDivider;
+
+	return true;
+}
+
+void telemetrySample(LP_TELEMETRY_SAMPLE lpSample)
+{
+	memcpy( &telemetryBatch[telemetryFill][telemetryCount], lpSample, sizeof(TELEMETRY_SAMPLE) );
+
+	if( TELEMETRY_SAMPLES == ++telemetryCount ) {
+		telemetryCount = 0;
+
+		// Sender still busy with the other batch, this one is dropped:
+		if( TELEMETRY_NONE != telemetryReady ) {
+			++telemetryOverruns;
+			return;
+		}
+
+		telemetryReady = telemetryFill;
+		telemetryFill ^= 1;
+	}
+}
@@ -0,0 +1,59 @@
+/*
+		simeon_s._ivanov@abv.bg
+
+			This File:
+	Create Date:	18.10.2026
+	Last Update:	18.10.2026
+*/
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TELEMETRY_PORT					5021	// UDP
+#define TELEMETRY_SAMPLES				32		// per datagram, must fit the MTU with the headers
+#define TELEMETRY_LEASE_MS				10000	// a subscription ends unless renewed meanwhile
+#define TELEMETRY_DEFAULT_DIVIDER		1		// every servo tick, 1 kHz
+#define NUMBER_OF_TELEMETRY_ADC			7
+
+// One sample of the servo state, little-endian as on the AVR:
+typedef struct {
+	uint32_t tick;			// servo tick number
+	int32_t position;		// encoder counts
+	int32_t command;		// commanded position, encoder counts
+	int32_t error;			// following error, command - position
+	int32_t pTerm;			// PID terms, times SCALING_FACTOR
+	int32_t iTerm;
+	int32_t dTerm;
+	uint16_t dac;			// arrDAC[0]
+	uint16_t adc[NUMBER_OF_TELEMETRY_ADC];	// arrADC[], counts
+} __attribute__((packed)) TELEMETRY_SAMPLE, *LP_TELEMETRY_SAMPLE;
+
+// Start of every datagram, followed by count samples:
+typedef struct {
+	uint32_t sequence;		// datagram number since the subscription
+	uint16_t count;			// samples in this datagram
+	uint16_t sampleSize;	// sizeof(TELEMETRY_SAMPLE)
+	uint16_t divider;		// servo ticks between two samples
+	uint16_t overruns;		// datagrams dropped since the subscription
+} __attribute__((packed)) TELEMETRY_HEADER, *LP_TELEMETRY_HEADER;
+
+/*
+	A host subscribes by sending a datagram to TELEMETRY_PORT, holding the
+	divider as a little-endian uint16_t, or nothing for the default. A divider
+	of 0 ends the subscription. Samples are then sent to the host in batches
+	of TELEMETRY_SAMPLES, until the subscription is not renewed for
+	TELEMETRY_LEASE_MS. One host is served at a time.
+
+	telemetryDue() and telemetrySample() are called from servoTick(), the
+	other functions from the main loop.
+*/
+void telemetryInit(void);
+bool telemetryTask(void);
+
+bool telemetryDue(void);
+void telemetrySample(LP_TELEMETRY_SAMPLE lpSample);
+
+#endif